@@ -0,0 +1,231 @@
+#pragma once
+// Period and velocity of a single object: still lifes, oscillators,
+// spaceships, and patterns that settle into one of those.
+//
+// The pattern runs on its own unbounded plane, kept as a sorted list of live
+// cells, so no board edge or neighbouring object can interfere. After every
+// generation the cells are shifted so their bounding box starts at (0, 0) and
+// hashed; when a hash comes round again and the cells really match, the
+// pattern has recurred, and the shift between the two sightings is its
+// displacement. Typical objects are done in well under a millisecond.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cpu_kernels.h"
+#include "life_board.h"
+
+// Live cells on an unbounded plane.
+class SparseLife {
+public:
+  SparseLife() = default;
+  explicit SparseLife(const LifeBoard &board) {
+    for (int y = 0; y < board.get_h(); ++y) {
+      const uint64_t *r = board.row(y);
+      for (int wi = 0; wi < board.get_stride(); ++wi) {
+        for (uint64_t bits = r[wi]; bits; bits &= bits - 1) {
+          cells_.push_back(key(wi * 64 + __builtin_ctzll(bits), y));
+        }
+      }
+    }
+  }
+
+  // Cells sort row by row; a neighbour is plain addition on the key.
+  static uint64_t key(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(y + kBias)) << 32) | static_cast<uint32_t>(x + kBias);
+  }
+  static int key_x(uint64_t k) { return static_cast<int>(static_cast<uint32_t>(k)) - kBias; }
+  static int key_y(uint64_t k) { return static_cast<int>(static_cast<uint32_t>(k >> 32)) - kBias; }
+
+  const std::vector<uint64_t> &cells() const { return cells_; }
+  size_t population() const { return cells_.size(); }
+
+  // Rules with B0 would fill the plane, so callers must reject them.
+  void step(const Rule &rule) {
+    static const int64_t kOffsets[8] {
+      -kRow - 1, -kRow, -kRow + 1, -1, 1, kRow - 1, kRow, kRow + 1,
+    };
+    around_.clear();
+    around_.reserve(cells_.size() * 8);
+    for (uint64_t k : cells_) {
+      for (int64_t off : kOffsets) { around_.push_back(k + static_cast<uint64_t>(off)); }
+    }
+    std::sort(around_.begin(), around_.end());
+
+    next_.clear();
+    size_t live {0};
+    for (size_t i = 0; i < around_.size();) {
+      const uint64_t k = around_[i];
+      size_t j = i + 1;
+      while (j < around_.size() && around_[j] == k) { ++j; }
+      while (live < cells_.size() && cells_[live] < k) { ++live; }
+      const bool alive = live < cells_.size() && cells_[live] == k;
+      if (rule.next(alive, static_cast<int>(j - i))) { next_.push_back(k); }
+      i = j;
+    }
+    // cells with no neighbours at all never showed up above
+    if (rule.survive & 1u) {
+      const size_t counted = next_.size();
+      for (uint64_t k : cells_) {
+        if (!std::binary_search(around_.begin(), around_.end(), k)) { next_.push_back(k); }
+      }
+      std::inplace_merge(next_.begin(), next_.begin() + static_cast<std::ptrdiff_t>(counted), next_.end());
+    }
+    cells_.swap(next_);
+  }
+
+  // Top-left corner of the bounding box; (0, 0) when empty.
+  void origin(int &x, int &y) const {
+    x = y = 0;
+    if (cells_.empty()) { return; }
+    y = key_y(cells_.front());
+    x = key_x(cells_.front());
+    for (uint64_t k : cells_) { x = std::min(x, key_x(k)); }
+  }
+
+  // The cells moved so the bounding box starts at (0, 0); still sorted.
+  std::vector<uint64_t> normalized() const {
+    int x {0}, y {0};
+    origin(x, y);
+    const uint64_t shift = key(x, y) - key(0, 0);
+    std::vector<uint64_t> out(cells_.size());
+    for (size_t i = 0; i < cells_.size(); ++i) { out[i] = cells_[i] - shift; }
+    return out;
+  }
+
+private:
+  static constexpr int kBias = 1 << 30;
+  static constexpr int64_t kRow = int64_t {1} << 32;
+
+  std::vector<uint64_t> cells_;  // sorted keys
+  std::vector<uint64_t> around_; // scratch: one entry per live neighbour
+  std::vector<uint64_t> next_;
+};
+
+struct AnalyzeLimits {
+  uint64_t max_generations {4096};
+  size_t   max_population {100000};
+};
+
+struct PatternAnalysis {
+  enum class Kind { kDies, kStill, kOscillator, kSpaceship, kUnknown };
+  Kind     kind {Kind::kUnknown};
+  uint64_t settle {0};       // first generation of the cycle (or of death)
+  uint64_t period {0};
+  int      dx {0};           // displacement per period
+  int      dy {0};
+  uint64_t min_population {0};  // over one cycle
+  uint64_t max_population {0};
+  uint64_t generations {0};  // generations actually stepped
+};
+
+// Steps pattern until a phase recurs, it dies, or a limit is hit. Only a
+// hash, position and population are kept per generation; a hash match is
+// confirmed by replaying the pattern up to the earlier phase.
+inline PatternAnalysis analyze_pattern(const LifeBoard &pattern, const Rule &rule, const AnalyzeLimits &limits = {}) {
+  using Kind = PatternAnalysis::Kind;
+  PatternAnalysis out;
+  if (rule.birth & 1u) { return out; }  // B0: every empty cell is born
+
+  struct Phase {
+    int x, y;  // where the bounding box was
+    uint64_t population;
+  };
+  std::vector<Phase> phases;
+  std::unordered_multimap<uint64_t, uint64_t> seen;  // hash of normalized cells -> generation
+  SparseLife life(pattern);
+
+  for (uint64_t gen = 0;; ++gen) {
+    if (life.population() == 0) {
+      out.kind = Kind::kDies;
+      out.settle = gen;
+      break;
+    }
+    const std::vector<uint64_t> cells = life.normalized();
+    Phase phase {0, 0, cells.size()};
+    life.origin(phase.x, phase.y);
+    uint64_t h = mix64(cells.size());
+    for (uint64_t k : cells) { h = mix64(h ^ k); }
+
+    auto range = seen.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+      const uint64_t then = it->second;
+      if (phases[then].population != phase.population) { continue; }
+      SparseLife replay(pattern);
+      for (uint64_t g = 0; g < then; ++g) { replay.step(rule); }
+      if (replay.normalized() != cells) { continue; }
+      out.settle = then;
+      out.period = gen - then;
+      out.dx = phase.x - phases[then].x;
+      out.dy = phase.y - phases[then].y;
+      out.kind = out.dx || out.dy ? Kind::kSpaceship : out.period == 1 ? Kind::kStill : Kind::kOscillator;
+      out.min_population = ~uint64_t {0};
+      for (size_t p = then; p < phases.size(); ++p) {
+        out.min_population = std::min(out.min_population, phases[p].population);
+        out.max_population = std::max(out.max_population, phases[p].population);
+      }
+      break;
+    }
+    if (out.period) { break; }
+    if (gen >= limits.max_generations || life.population() > limits.max_population) { break; }
+
+    seen.emplace(h, gen);
+    phases.push_back(phase);
+    life.step(rule);
+    out.generations = gen + 1;
+  }
+  return out;
+}
+
+inline const char *analysis_kind_name(PatternAnalysis::Kind kind) {
+  switch (kind) {
+    case PatternAnalysis::Kind::kDies:       return "dies";
+    case PatternAnalysis::Kind::kStill:      return "still";
+    case PatternAnalysis::Kind::kOscillator: return "oscillator";
+    case PatternAnalysis::Kind::kSpaceship:  return "spaceship";
+    default:                                 return "unknown";
+  }
+}
+
+// Speed in the usual notation, e.g. "c/4 diagonal" or "2c/5 orthogonal".
+inline std::string format_velocity(int dx, int dy, uint64_t period) {
+  const uint64_t ax = static_cast<uint64_t>(std::abs(dx)), ay = static_cast<uint64_t>(std::abs(dy));
+  const uint64_t fast = std::max(ax, ay);
+  if (fast == 0 || period == 0) { return "c/0"; }
+  const uint64_t g = std::gcd(fast, period);
+  const char *dir = ax == 0 || ay == 0 ? "orthogonal" : ax == ay ? "diagonal" : "oblique";
+  char text[96];
+  if (fast / g == 1) {
+    std::snprintf(text, sizeof(text), "c/%llu %s", static_cast<unsigned long long>(period / g), dir);
+  } else {
+    std::snprintf(text, sizeof(text), "%lluc/%llu %s", static_cast<unsigned long long>(fast / g),
+                  static_cast<unsigned long long>(period / g), dir);
+  }
+  return text;
+}
+
+// One line for logs.
+inline std::string format_analysis(const PatternAnalysis &a) {
+  char text[192];
+  switch (a.kind) {
+    case PatternAnalysis::Kind::kDies:
+      std::snprintf(text, sizeof(text), "dies at generation %llu", static_cast<unsigned long long>(a.settle));
+      break;
+    case PatternAnalysis::Kind::kUnknown:
+      std::snprintf(text, sizeof(text), "no period within %llu generations", static_cast<unsigned long long>(a.generations));
+      break;
+    default:
+      std::snprintf(text, sizeof(text), "%s, period %llu, displacement (%d, %d)%s%s, population %llu..%llu, from generation %llu",
+                    analysis_kind_name(a.kind), static_cast<unsigned long long>(a.period), a.dx, a.dy,
+                    a.kind == PatternAnalysis::Kind::kSpaceship ? ", " : "",
+                    a.kind == PatternAnalysis::Kind::kSpaceship ? format_velocity(a.dx, a.dy, a.period).c_str() : "",
+                    static_cast<unsigned long long>(a.min_population), static_cast<unsigned long long>(a.max_population),
+                    static_cast<unsigned long long>(a.settle));
+      break;
+  }
+  return text;
+}
@@ -0,0 +1,546 @@
+#pragma once
+// Background file I/O so saves, loads and recordings never stall a frame.
+//
+// Requests are queued to one I/O thread and results come back through
+// poll_completions(), which the main loop calls once per frame; callbacks
+// therefore run on the main thread. On Linux the thread drives io_uring and
+// keeps several chunks of a large file in flight; when the kernel refuses
+// io_uring it falls back to pread/pwrite, and other platforms use stdio.
+//
+// Whole-file writes go to "<path>.tmp" and are renamed over <path> when
+// complete, so readers never see a half-written file.
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define AUTO_CELL_HAS_POSIX_IO 1
+#endif
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+struct IoResult {
+  bool              ok {false};
+  std::string       path;
+  std::vector<char> data;   // file contents for reads
+  std::string       error;
+};
+
+using IoCallback = std::function<void(IoResult &)>;
+
+namespace io_detail {
+
+constexpr size_t kChunk = 1u << 20;  // bytes per read/write submission
+
+#if defined(__linux__)
+
+// Minimal io_uring wrapper over the raw syscalls; no liburing dependency.
+class Uring {
+public:
+  Uring() = default;
+  Uring(const Uring&) = delete;
+  ~Uring() { reset(); }
+
+  // Unmaps the rings and closes the ring fd; init() can then set up a new one.
+  void reset() {
+    if (sqes_)   { munmap(sqes_, sqes_size_); }
+    if (cq_ptr_ && cq_ptr_ != sq_ptr_) { munmap(cq_ptr_, cq_size_); }
+    if (sq_ptr_) { munmap(sq_ptr_, sq_size_); }
+    if (fd_ >= 0) { close(fd_); }
+    fd_ = -1;
+    sq_ptr_ = cq_ptr_ = nullptr;
+    sqes_ = nullptr;
+    entries_ = to_submit_ = 0;
+  }
+
+  bool init(unsigned entries) {
+    reset();  // AsyncIo::start() after stop() sets the ring up again
+    io_uring_params p {};
+    fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+    if (fd_ < 0) { return false; }
+
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single) { sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_; }
+
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) { sq_ptr_ = nullptr; return false; }
+    cq_ptr_ = single ? sq_ptr_ : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) { cq_ptr_ = nullptr; return false; }
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    void *sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) { return false; }
+    sqes_ = static_cast<io_uring_sqe *>(sqes);
+
+    char *sq = static_cast<char *>(sq_ptr_);
+    char *cq = static_cast<char *>(cq_ptr_);
+    sq_tail_  = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_mask_  = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    cq_head_  = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cq_tail_  = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cq_mask_  = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    cqes_     = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    entries_  = p.sq_entries;
+    return true;
+  }
+
+  unsigned entries() const { return entries_; }
+
+  // Queues a read or write at offset; user_data comes back in the completion.
+  void prep(uint8_t op, int fd, void *buf, unsigned len, uint64_t offset, uint64_t user_data) {
+    unsigned tail = *sq_tail_;
+    unsigned idx = tail & sq_mask_;
+    io_uring_sqe &sqe = sqes_[idx];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode    = op;
+    sqe.fd        = fd;
+    sqe.addr      = reinterpret_cast<uint64_t>(buf);
+    sqe.len       = len;
+    sqe.off       = offset;
+    sqe.user_data = user_data;
+    sq_array_[idx] = idx;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    ++to_submit_;
+  }
+
+  bool submit_and_wait(unsigned wait_nr) {
+    for (;;) {
+      long r = syscall(__NR_io_uring_enter, fd_, to_submit_, wait_nr, IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (r >= 0) { to_submit_ -= static_cast<unsigned>(r); return true; }
+      if (errno != EINTR) { return false; }
+    }
+  }
+
+  // Takes back SQEs queued since the last successful submit, which the
+  // kernel hasn't seen yet; returns how many.
+  unsigned drop_unsubmitted() {
+    const unsigned n = to_submit_;
+    __atomic_store_n(sq_tail_, *sq_tail_ - n, __ATOMIC_RELEASE);
+    to_submit_ = 0;
+    return n;
+  }
+
+  bool pop(io_uring_cqe &out) {
+    unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) { return false; }
+    out = cqes_[head & cq_mask_];
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+private:
+  int fd_ {-1};
+  void  *sq_ptr_ {nullptr};
+  void  *cq_ptr_ {nullptr};
+  size_t sq_size_ {0};
+  size_t cq_size_ {0};
+  io_uring_sqe *sqes_ {nullptr};
+  size_t sqes_size_ {0};
+  unsigned *sq_tail_ {nullptr};
+  unsigned  sq_mask_ {0};
+  unsigned *sq_array_ {nullptr};
+  unsigned *cq_head_ {nullptr};
+  unsigned *cq_tail_ {nullptr};
+  unsigned  cq_mask_ {0};
+  io_uring_cqe *cqes_ {nullptr};
+  unsigned entries_ {0};
+  unsigned to_submit_ {0};
+};
+
+#endif
+
+} // namespace io_detail
+
+class AsyncIo {
+public:
+  AsyncIo() = default;
+  AsyncIo(const AsyncIo&) = delete;
+  ~AsyncIo() { stop(); }
+
+  void start() {
+    if (thread_.joinable()) { return; }
+#if defined(__linux__)
+    use_uring_ = uring_.init(8);
+#endif
+    SDL_Log("io: using %s", use_uring_ ? "io_uring" : "blocking calls on the I/O thread");
+    quit_ = false;
+    thread_ = std::thread([this] { run_(); });
+  }
+
+  // Finishes queued work, then joins the I/O thread. Results not yet
+  // collected stay available to poll_completions().
+  void stop() {
+    if (!thread_.joinable()) { return; }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  // Atomically replaces path with data. With durable, the data is fsync'ed
+  // before the rename.
+  void write_file(std::string path, std::vector<char> data, IoCallback done = nullptr, bool durable = false) {
+    Request r;
+    r.kind    = Kind::kWriteFile;
+    r.path    = std::move(path);
+    r.data    = std::move(data);
+    r.done    = std::move(done);
+    r.durable = durable;
+    push_(std::move(r));
+  }
+
+  // Like write_file(), but produce() builds the contents on the I/O thread,
+  // e.g. to serialize a snapshot without spending main-thread time on it.
+  void write_file_with(std::string path, std::function<std::vector<char>()> produce,
+                       IoCallback done = nullptr, bool durable = false) {
+    Request r;
+    r.kind    = Kind::kWriteFile;
+    r.path    = std::move(path);
+    r.produce = std::move(produce);
+    r.done    = std::move(done);
+    r.durable = durable;
+    push_(std::move(r));
+  }
+
+  void read_file(std::string path, IoCallback done, size_t max_bytes = size_t {64} << 20) {
+    Request r;
+    r.kind      = Kind::kReadFile;
+    r.path      = std::move(path);
+    r.done      = std::move(done);
+    r.max_bytes = max_bytes;
+    push_(std::move(r));
+  }
+
+  // Called on the I/O thread each time a request with a callback finishes,
+  // so a main loop that sleeps between frames can be woken to collect it.
+  // Set before start().
+  void set_on_complete(std::function<void()> fn) { on_complete_ = std::move(fn); }
+
+  // Runs callbacks of finished requests on the calling thread. Returns how many ran.
+  size_t poll_completions() {
+    std::deque<Request> ready;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ready.swap(done_);
+    }
+    for (Request &r : ready) { r.done(r.result); }
+    return ready.size();
+  }
+
+  // True while requests are queued or being worked on.
+  bool busy() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return in_flight_ > 0;
+  }
+
+  // Double-buffered append stream for recordings. The producer copies into
+  // the front buffer; flush() hands it to the I/O thread as the back buffer
+  // once the previous one has been written, otherwise data keeps
+  // accumulating in front. Neither call waits for the disk.
+  class Stream {
+  public:
+    Stream(AsyncIo &io, std::string path, size_t flush_bytes = size_t {256} << 10)
+      : io_{io}, path_{std::move(path)}, flush_bytes_{flush_bytes},
+        writing_{std::make_shared<std::atomic<bool>>(false)} {}
+    Stream(const Stream&) = delete;
+    ~Stream() { flush(true); }
+
+    void append(const void *data, size_t size) {
+      const char *p = static_cast<const char *>(data);
+      front_.insert(front_.end(), p, p + size);
+      if (front_.size() >= flush_bytes_) { flush(); }
+    }
+
+    // With force, queues the front buffer even if the back one is still in
+    // flight; requests are served in order, so the file stays sequential.
+    void flush(bool force = false) {
+      if (front_.empty()) { return; }
+      if (!force && writing_->load(std::memory_order_acquire)) { return; }
+      writing_->store(true, std::memory_order_relaxed);
+      std::vector<char> back;
+      back.swap(front_);
+      front_.reserve(back.capacity());
+
+      Request r;
+      r.kind    = Kind::kAppend;
+      r.path    = path_;
+      r.data    = std::move(back);
+      r.release = writing_;
+      io_.push_(std::move(r));
+    }
+
+  private:
+    AsyncIo &io_;
+    std::string path_;
+    size_t flush_bytes_;
+    std::vector<char> front_;
+    std::shared_ptr<std::atomic<bool>> writing_;
+  };
+
+private:
+  enum class Kind { kWriteFile, kReadFile, kAppend };
+
+  struct Request {
+    Kind kind {Kind::kWriteFile};
+    std::string path;
+    std::vector<char> data;
+    std::function<std::vector<char>()> produce;
+    IoCallback done;
+    bool durable {false};
+    size_t max_bytes {0};
+    std::shared_ptr<std::atomic<bool>> release;  // cleared once an append lands
+    IoResult result;
+  };
+
+  std::thread thread_;
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Request> queue_;
+  std::deque<Request> done_;
+  std::function<void()> on_complete_;
+  size_t in_flight_ {0};
+  bool quit_ {false};
+  bool use_uring_ {false};
+#if defined(__linux__)
+  io_detail::Uring uring_;
+#endif
+
+  void push_(Request r) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(std::move(r));
+      ++in_flight_;
+    }
+    wake_.notify_one();
+  }
+
+  void run_() {
+    for (;;) {
+      Request r;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [this] { return quit_ || !queue_.empty(); });
+        if (queue_.empty()) { return; }
+        r = std::move(queue_.front());
+        queue_.pop_front();
+      }
+      r.result.path = r.path;
+      if (r.produce) {
+        r.data = r.produce();
+        r.produce = nullptr;
+      }
+      switch (r.kind) {
+        case Kind::kWriteFile: write_file_(r); break;
+        case Kind::kReadFile:  read_file_(r);  break;
+        case Kind::kAppend:    append_(r);     break;
+      }
+      if (!r.result.ok) { SDL_Log("io: %s: %s", r.path.c_str(), r.result.error.c_str()); }
+      if (r.release) { r.release->store(false, std::memory_order_release); }
+      r.data.clear();
+
+      bool notify {false};
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --in_flight_;
+        if (r.done) {
+          done_.push_back(std::move(r));
+          notify = static_cast<bool>(on_complete_);
+        }
+      }
+      if (notify) { on_complete_(); }
+    }
+  }
+
+  static void fail_(Request &r, const char *what) {
+    r.result.ok = false;
+    r.result.error = std::string(what) + ": " + strerror(errno);
+  }
+
+#if defined(AUTO_CELL_HAS_POSIX_IO)
+
+  // Transfers len bytes at offset: through io_uring with several chunks in
+  // flight when available, otherwise a pread/pwrite loop.
+  bool transfer_(bool write, int fd, char *buf, size_t len, uint64_t offset) {
+#if defined(__linux__)
+    if (use_uring_) {
+      const uint8_t op = write ? IORING_OP_WRITE : IORING_OP_READ;
+      size_t queued {0}, completed {0};
+      unsigned in_flight {0};
+      int error {0};             // first I/O errno; after one, nothing more is queued
+      int ring_failed {0};       // errno of a failed io_uring_enter: finish on pread/pwrite
+      // every chunk in flight points into buf, so neither an I/O error nor a
+      // failing ring hands buf back before all of them have completed
+      while (error || ring_failed ? in_flight > 0 : completed < len) {
+        while (!error && !ring_failed && queued < len && in_flight < uring_.entries()) {
+          size_t n = len - queued < io_detail::kChunk ? len - queued : io_detail::kChunk;
+          uring_.prep(op, fd, buf + queued, static_cast<unsigned>(n), offset + queued, queued);
+          queued += n;
+          ++in_flight;
+        }
+        if (!uring_.submit_and_wait(1)) {
+          const int e = errno;
+          in_flight -= uring_.drop_unsubmitted();
+          if (e != EAGAIN && e != EBUSY) {
+            if (!ring_failed) { SDL_Log("io: io_uring_enter failed: %s", strerror(e)); }
+            ring_failed = e;
+            // the kernel still posts completions for what it accepted; keep
+            // polling the completion ring between waits until all are back
+            if (in_flight > 0) { std::this_thread::sleep_for(std::chrono::microseconds(200)); }
+          }
+        }
+        io_uring_cqe cqe;
+        while (uring_.pop(cqe)) {
+          --in_flight;
+          if (error || ring_failed) { continue; }
+          size_t at = static_cast<size_t>(cqe.user_data);
+          size_t want = len - at < io_detail::kChunk ? len - at : io_detail::kChunk;
+          if (cqe.res < 0) {
+            error = -cqe.res;
+            continue;
+          }
+          size_t got = static_cast<size_t>(cqe.res);
+          // a short transfer finishes synchronously
+          if (got < want && !transfer_sync_(write, fd, buf + at + got, want - got, offset + at + got)) {
+            error = errno;
+            continue;
+          }
+          completed += want;
+        }
+      }
+      if (error) {
+        errno = error;
+        return false;
+      }
+      if (!ring_failed) { return true; }
+      // nothing of buf is in the kernel's hands any more; ENOMEM can pass, so
+      // only a ring that failed otherwise is given up for good
+      if (ring_failed != ENOMEM) { use_uring_ = false; }
+    }
+#endif
+    return transfer_sync_(write, fd, buf, len, offset);
+  }
+
+  static bool transfer_sync_(bool write, int fd, char *buf, size_t len, uint64_t offset) {
+    while (len > 0) {
+      ssize_t n = write ? pwrite(fd, buf, len, static_cast<off_t>(offset)) : pread(fd, buf, len, static_cast<off_t>(offset));
+      if (n < 0 && errno == EINTR) { continue; }
+      if (n <= 0) {
+        if (n == 0) { errno = EIO; }
+        return false;
+      }
+      buf += n;
+      len -= static_cast<size_t>(n);
+      offset += static_cast<uint64_t>(n);
+    }
+    return true;
+  }
+
+  void write_file_(Request &r) {
+    const std::string tmp = r.path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) { return fail_(r, "open"); }
+    bool ok = transfer_(true, fd, r.data.data(), r.data.size(), 0);
+    if (ok && r.durable) { ok = fsync(fd) == 0; }
+    if (!ok) { fail_(r, "write"); }
+    close(fd);
+    if (!ok) { unlink(tmp.c_str()); return; }
+    if (rename(tmp.c_str(), r.path.c_str()) < 0) { return fail_(r, "rename"); }
+    if (r.durable) {
+      // make the rename itself survive a crash
+      size_t slash = r.path.find_last_of('/');
+      std::string dir = slash == std::string::npos ? "." : r.path.substr(0, slash + 1);
+      int dfd = open(dir.c_str(), O_RDONLY);
+      if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+      }
+    }
+    r.result.ok = true;
+  }
+
+  void read_file_(Request &r) {
+    int fd = open(r.path.c_str(), O_RDONLY);
+    if (fd < 0) { return fail_(r, "open"); }
+    struct stat st {};
+    if (fstat(fd, &st) < 0) { fail_(r, "stat"); close(fd); return; }
+    if (static_cast<uint64_t>(st.st_size) > r.max_bytes) {
+      r.result.error = "file too large";
+      close(fd);
+      return;
+    }
+    r.result.data.resize(static_cast<size_t>(st.st_size));
+    bool ok = transfer_(false, fd, r.result.data.data(), r.result.data.size(), 0);
+    if (!ok) { fail_(r, "read"); }
+    close(fd);
+    r.result.ok = ok;
+  }
+
+  void append_(Request &r) {
+    int fd = open(r.path.c_str(), O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) { return fail_(r, "open"); }
+    struct stat st {};
+    bool ok = fstat(fd, &st) == 0 && transfer_(true, fd, r.data.data(), r.data.size(), static_cast<uint64_t>(st.st_size));
+    if (!ok) { fail_(r, "append"); }
+    close(fd);
+    r.result.ok = ok;
+  }
+
+#else
+
+  void write_file_(Request &r) {
+    const std::string tmp = r.path + ".tmp";
+    FILE *f = std::fopen(tmp.c_str(), "wb");
+    if (!f) { return fail_(r, "open"); }
+    bool ok = std::fwrite(r.data.data(), 1, r.data.size(), f) == r.data.size();
+    ok = std::fclose(f) == 0 && ok;
+    std::remove(r.path.c_str());
+    if (!ok || std::rename(tmp.c_str(), r.path.c_str()) != 0) { return fail_(r, "write"); }
+    r.result.ok = true;
+  }
+
+  void read_file_(Request &r) {
+    FILE *f = std::fopen(r.path.c_str(), "rb");
+    if (!f) { return fail_(r, "open"); }
+    char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0 && r.result.data.size() + n <= r.max_bytes) {
+      r.result.data.insert(r.result.data.end(), buf, buf + n);
+    }
+    r.result.ok = !std::ferror(f) && n == 0;
+    if (!r.result.ok) { r.result.error = "read failed or file too large"; }
+    std::fclose(f);
+  }
+
+  void append_(Request &r) {
+    FILE *f = std::fopen(r.path.c_str(), "ab");
+    if (!f) { return fail_(r, "open"); }
+    bool ok = std::fwrite(r.data.data(), 1, r.data.size(), f) == r.data.size();
+    r.result.ok = std::fclose(f) == 0 && ok;
+    if (!r.result.ok) { fail_(r, "append"); }
+  }
+
+#endif
+};
@@ -16,82 +16,74 @@
 #include <cassert>
 #include <memory>
 #include <limits>
-#include <chrono>
-#include <random>
+#include <algorithm>
+#include "life_board.h"
+#include "shard.h"
+#include "headless.h"
+#include "shm_ring.h"
+#include "control_server.h"
+#include "sim_hooks.h"
+#include "async_io.h"
+#include "pattern_io.h"
+#include "checkpoint.h"
+#include "frame_export.h"
+#include "image_diff.h"
+#include "selftest.h"
+#include "bench.h"
+#include "analyzer.h"
+#include "frame_tasks.h"
+#include "input_queue.h"
+#include "series_ring.h"
+#include "rule_sweep.h"
+#include "soup_search.h"
 
 static SDL_Window *window = NULL;
 static SDL_Renderer *renderer = NULL;
+static AsyncIo gIo;
+static FrameScheduler gTasks;  // after gIo: tasks may be waiting on its callbacks
+static Uint32 gWakeEvent {0};  // pushed from the I/O thread when a request finishes
+static InputQueue gInput;
 
 using CellShape = SDL_Rect;
-using CellShake = SDL_FPoint;
 #define MAX_CELL_COUNT 16384
 
 
 
-// This header-only Random namespace implements a self-seeding Mersenne Twister.
-// Requires C++17 or newer.
-// It can be #included into as many code files as needed (The inline keyword avoids ODR violations)
-// Freely redistributable, courtesy of learncpp.com (https://www.learncpp.com/cpp-tutorial/global-random-numbers-random-h/)
-namespace Random
-{
-	inline std::mt19937 generate()
-	{
-		std::random_device rd{};
-
-		// Create seed_seq with clock and 7 random numbers from std::random_device
-		std::seed_seq ss{
-			static_cast<std::seed_seq::result_type>(std::chrono::steady_clock::now().time_since_epoch().count()),
-				rd(), rd(), rd(), rd(), rd(), rd(), rd() };
-
-		return std::mt19937{ ss };
-	}
-
-	inline std::mt19937 mt{ generate() }; // generates a seeded std::mt19937 and copies it into our global object
-
-	inline int get(int min, int max)
-	{
-		return std::uniform_int_distribution{min, max}(mt);
-	}
-
-	template <typename T>
-	T get(T min, T max)
-	{
-		return std::uniform_int_distribution<T>{min, max}(mt);
-	}
-
-	template <typename R, typename S, typename T>
-	R get(S min, T max)
-	{
-		return get<R>(static_cast<R>(min), static_cast<R>(max));
-	}
+// Paused cells jitter by up to a pixel each way. The offset is a hash of the
+// cell's index and the frame number, so nothing is stored per cell and the
+// same frame always looks the same. Plain 32-bit integer ops, so the loop in
+// draw_cells_() vectorizes.
+inline uint32_t shake_hash(uint32_t cell, uint32_t frame) {
+  uint32_t h = cell * 0x9e3779b9u ^ frame * 0x85ebca6bu;
+  h ^= h >> 16;
+  h *= 0x7feb352du;
+  h ^= h >> 15;
+  h *= 0x846ca68bu;
+  h ^= h >> 16;
+  return h;
 }
 
+// -1, 0 or 1 from 16 bits of a hash.
+inline int shake_offset(uint32_t bits16) { return static_cast<int>((bits16 * 3u) >> 16) - 1; }
+
 class Cell {
 public:
   Cell() = default;
   Cell(CellShape shape, bool is_active) : shape_{shape_}, is_active_{is_active} {}
-  bool get_active_state() { return is_active_; }
+  bool get_active_state() const { return is_active_; }
   Cell& set_active_state(bool s) { is_active_ = s; return *this; }
-  bool get_wait_state() { return wait_for_select_; }
-  Cell& set_wait_state(bool s) { wait_for_select_ = s; return *this; }
-  CellShape get_shape() { return shape_; }
+  CellShape get_shape() const { return shape_; }
   Cell& set_shape(CellShape shape) { shape_ = shape; return *this; }
-  CellShake get_shake() { return shake_; }
-  Cell& set_shake(CellShake s) { shake_ = s; return *this; }
-  bool  get_active_change() { return active_change; }
+  bool  get_active_change() const { return active_change; }
   Cell& set_active_change(bool s) { active_change = s; return *this; }
 
 private:
   bool      is_active_ {false};
-  bool      wait_for_select_ {false};
   bool      active_change {false};
   CellShape shape_;
-
-  // active has [-1, 1] value
-  CellShake shake_ {0.0f, 0.0f};
 };
 
-class CellGrand {
+class CellGrand : public ControlTarget {
 public:
   CellGrand(const CellGrand&) = delete;
   CellGrand(int side, int w, int h): side_{side}, w_{w}, h_{h} {
@@ -100,58 +92,116 @@ public:
     init_cells_();
   }
 
-  void handle_input(SDL_Event *event) {
-    float mouse_x, mouse_y;
-    SDL_GetMouseState(&mouse_x, &mouse_y);
-    mouse_x /= scale_x_;
-    mouse_y /= scale_y_;
-    for(int i = 0; i < cell_count_; ++i) {
-      if (mouse_x >= cells_[i].get_shape().x && mouse_x <= cells_[i].get_shape().x + side_ &&
-          mouse_y >= cells_[i].get_shape().y && mouse_y <= cells_[i].get_shape().y + side_)
-      {
-        cells_[i].set_wait_state(true);
-      }
-      else
-      {
-        cells_[i].set_wait_state(false);
-      }
-
-      if (!start_ && cells_[i].get_wait_state() && event->type == SDL_EVENT_MOUSE_BUTTON_DOWN && event->button.button == SDL_BUTTON_LEFT) {
-        if (!cells_[i].get_active_state()) {
-          cells_[i].set_active_state(true);
-          ready_++;
-        } else {
-          cells_[i].set_active_state(false);
-          ready_--;
+  // Applies one frame's input. Clicks and keys run in arrival order; cells
+  // clicked in a row are toggled on the grid together, before the next key
+  // sees them. Hover follows the latest pointer position. Returns false if
+  // nothing on screen changed, e.g. the pointer moved within a cell.
+  bool apply_input(const InputBatch &batch) {
+    const int hover = hover_;
+    for (const SDL_Event &e : batch.events) {
+      if (e.type == SDL_EVENT_MOUSE_BUTTON_DOWN) {
+        if (!attached_ && !start_ && e.button.button == SDL_BUTTON_LEFT) {
+          const int i = cell_at_(e.button.x, e.button.y);
+          if (i >= 0) { edits_.push_back(i); }
         }
+      } else if (e.type == SDL_EVENT_KEY_DOWN) {
+        flush_edits_();
+        handle_key_(e.key.scancode);
       }
     }
-
-    if (ready_ > 0 && event->type == SDL_EVENT_KEY_DOWN) {
-      if (event->key.scancode == SDL_SCANCODE_RETURN) {
-        start_ = !start_;
-      }
+    flush_edits_();
+    if (batch.moved) {
+      hover_ = cell_at_(batch.pointer.x, batch.pointer.y);
     }
 
     if (start_ && ready_ <= 0) {
       start_ = false;
       ready_ = 0;
     }
+    return !batch.events.empty() || hover_ != hover;
   }
 
   bool play() {
     update_();
-    ai_();
+    if (!attached_) {
+      ai_();
+    }
     draw_cells_();
+    if (!attached_ && show_series_) {
+      draw_series_();
+    }
     return start_;
   }
 
+  // Frame number the next shake is drawn for; fixing it fixes the jitter.
+  void set_shake_frame(uint32_t frame) { shake_frame_ = frame; }
+
+  // Shows frames published by a headless run instead of the local board.
+  void attach(const ShmRingReader *ring) { attached_ = ring; }
+  bool attached() const { return attached_; }
+  bool running() const { return start_; }
+
   int get_side() const { return side_; }
   int get_w()    const { return w_; }
   int get_h()    const { return h_; }
 
+  // ControlTarget
+  int  board_w() const override { return w_; }
+  int  board_h() const override { return h_; }
+  bool cell(int x, int y) const override { return cells_[index_(x, y)].get_active_state(); }
+  void set_cell(int x, int y, bool alive) override {
+    Cell &c = cells_[index_(x, y)];
+    if (c.get_active_state() != alive) {
+      c.set_active_state(alive);
+      ready_ += alive ? 1 : -1;
+    }
+  }
+  void clear_board() override {
+    for (int i = 0; i < cell_count_; ++i) {
+      cells_[i].set_active_state(false).set_active_change(false);
+    }
+    ready_ = 0;
+    generation_ = 0;
+    series_.clear();
+  }
+  void step(int generations) override {
+    for (int g = 0; g < generations; ++g) {
+      step_();
+    }
+  }
+  void set_running(bool running) override { start_ = running; }
+  uint64_t population() const override { return static_cast<uint64_t>(ready_); }
+  uint64_t generation() const override { return generation_; }
+
+  LifeBoard to_board() const {
+    LifeBoard board(w_, h_);
+    for (int i = 0; i < w_; ++i) {
+      for (int j = 0; j < h_; ++j) {
+        if (cell(i, j)) { board.set(i, j, true); }
+      }
+    }
+    return board;
+  }
+
+  // Replaces the board with pattern, centered and clipped to the grid.
+  void load_board(const LifeBoard &pattern) {
+    clear_board();
+    const int ox = (w_ - pattern.get_w()) / 2;
+    const int oy = (h_ - pattern.get_h()) / 2;
+    // only the part of a large pattern that lands on the grid is visited
+    for (int y = std::max(0, -oy); y < std::min(pattern.get_h(), h_ - oy); ++y) {
+      for (int x = std::max(0, -ox); x < std::min(pattern.get_w(), w_ - ox); ++x) {
+        if (pattern.get(x, y)) {
+          set_cell(x + ox, y + oy, true);
+        }
+      }
+    }
+  }
+
 private:
   void check_valid() { assert(side_>=3 && "error: side must be >= 3 pixels"); }
+  // cells are stored column by column
+  int index_(int x, int y) const { return x * h_ + y; }
   int side_;
   int w_;
   int h_;
@@ -161,44 +211,200 @@ private:
   float scale_y_;
   int   ready_ {0};
   bool  start_ {false};
+  uint64_t generation_ {0};
+
+  static constexpr int kGap = 2;  // pixels between cells
+  SDL_Point origin_ {0, 0};       // top-left of the first cell
+  int hover_ {-1};                // cell under the pointer
+  std::vector<int> edits_;        // cells clicked since the last flush
+
+  SeriesRing<4096> series_;       // one sample per generation stepped here
+  bool show_series_ {true};
+  std::vector<SeriesSample> plot_;// scratch for draw_series_()
+
+  uint32_t shake_frame_ {0};           // frames drawn, for shake_hash()
+  std::vector<SDL_FRect> outlines_;    // scratch for draw_cells_()
+  std::vector<SDL_FRect> filled_;
+  std::vector<uint32_t> filled_index_;
+  std::vector<SDL_FRect> ring_filled_;  // live cells of the last intact frame when attached
+  std::vector<float> shake_;
+
+  const ShmRingReader *attached_ {nullptr};
+  int view_x_ {0};  // board cell shown in the top-left corner when attached
+  int view_y_ {0};
+
+  static constexpr const char *kSaveFile = "auto_cell.rle";
+
+  static constexpr uint64_t kJumpGenerations = 1000;
+
+  // The long jobs below run as tasks on gTasks, a slice per frame, so the
+  // window keeps drawing and taking input while they work.
+  Task save_() {
+    LifeBoard board = to_board();
+    co_await gTasks.yield();
+    std::string rle = write_rle(board, Rule{});
+    co_await gTasks.yield();
+    IoResult r = co_await gTasks.write(gIo, kSaveFile, std::vector<char>(rle.begin(), rle.end()));
+    if (r.ok) { SDL_Log("saved %s", r.path.c_str()); }
+  }
+
+  Task load_() {
+    IoResult r = co_await gTasks.read(gIo, kSaveFile);
+    if (!r.ok) { co_return; }
+    LifeBoard pattern;
+    std::string error;
+    if (!parse_rle(r.data.data(), r.data.size(), pattern, nullptr, &error)) {
+      SDL_Log("%s: %s", r.path.c_str(), error.c_str());
+      co_return;
+    }
+    co_await gTasks.yield();
+    if (!start_) {
+      load_board(pattern);
+      SDL_Log("loaded %s", r.path.c_str());
+    }
+  }
+
+  static constexpr const char *kSeriesFile = "auto_cell_series.csv";
+
+  Task dump_series_() {
+    std::vector<SeriesSample> samples;
+    series_.read(samples);
+    std::string csv = series_csv(samples);
+    co_await gTasks.yield();
+    IoResult r = co_await gTasks.write(gIo, kSeriesFile, std::vector<char>(csv.begin(), csv.end()));
+    if (r.ok) { SDL_Log("saved %zu generations to %s", samples.size(), r.path.c_str()); }
+  }
+
+  // Steps a packed copy of the board a few generations per slice and shows
+  // the result at the end, unless the board was edited or run meanwhile.
+  Task jump_(uint64_t generations) {
+    const uint64_t from = generation_;
+    LifeBoard board = to_board();
+    const uint64_t before = board.hash();
+    std::vector<SeriesSample> samples;
+    for (uint64_t g = 0; g < generations; ++g) {
+      const LifeBoard prev = board;
+      board.step(Rule{});
+      SeriesSample s {from + g + 1, 0, 0, 0};
+      for (int y = 0; y < board.get_h(); ++y) {
+        for (int i = 0; i < board.get_stride(); ++i) {
+          const uint64_t was = prev.row(y)[i], now = board.row(y)[i];
+          s.population += static_cast<uint64_t>(__builtin_popcountll(now));
+          s.births     += static_cast<uint64_t>(__builtin_popcountll(now & ~was));
+          s.deaths     += static_cast<uint64_t>(__builtin_popcountll(was & ~now));
+        }
+      }
+      samples.push_back(s);
+      co_await gTasks.yield();
+    }
+    if (generation_ != from || to_board().hash() != before) {
+      SDL_Log("jump: board changed while stepping, dropped");
+      co_return;
+    }
+    load_board(board);
+    generation_ = from + generations;
+    for (const SeriesSample &s : samples) { series_.push(s); }
+    SDL_Log("jumped to generation %llu", static_cast<unsigned long long>(generation_));
+  }
+
+  void handle_key_(SDL_Scancode key) {
+    if (attached_) {
+      pan_view_(key);
+      return;
+    }
+
+    if (ready_ > 0 && key == SDL_SCANCODE_RETURN) {
+      start_ = !start_;
+    }
+
+    if (key == SDL_SCANCODE_S) {
+      show_series_ = !show_series_;
+    } else if (key == SDL_SCANCODE_C) {
+      gTasks.spawn("series", dump_series_());
+    }
+
+    if (!start_) {
+      if (key == SDL_SCANCODE_F5) {
+        gTasks.spawn("save", save_());
+      } else if (key == SDL_SCANCODE_F9) {
+        gTasks.spawn("load", load_());
+      } else if (key == SDL_SCANCODE_J) {
+        gTasks.spawn("jump", jump_(kJumpGenerations));
+      }
+    }
+  }
+
+  // Toggles every cell clicked since the last flush in one pass over the
+  // grid; a cell clicked an even number of times stays as it was.
+  void flush_edits_() {
+    if (edits_.empty()) { return; }
+    std::sort(edits_.begin(), edits_.end());
+    for (size_t k = 0; k < edits_.size();) {
+      size_t run = k;
+      while (run < edits_.size() && edits_[run] == edits_[k]) { ++run; }
+      if ((run - k) % 2 == 1) {
+        Cell &c = cells_[edits_[k]];
+        c.set_active_state(!c.get_active_state());
+        ready_ += c.get_active_state() ? 1 : -1;
+      }
+      k = run;
+    }
+    edits_.clear();
+  }
+
+  // Cell under window position (x, y), or -1 over a gap or off the grid.
+  int cell_at_(float x, float y) const {
+    const float px = x / scale_x_ - origin_.x;
+    const float py = y / scale_y_ - origin_.y;
+    if (px < 0 || py < 0) { return -1; }
+    const int pitch = side_ + kGap;
+    const int i = static_cast<int>(px) / pitch;
+    const int j = static_cast<int>(py) / pitch;
+    // edges count as inside, like SDL's own rect tests
+    if (i >= w_ || j >= h_ || px - i * pitch > side_ || py - j * pitch > side_) { return -1; }
+    return index_(i, j);
+  }
+
+  void pan_view_(SDL_Scancode key) {
+    const int kStep = 8;
+    switch (key) {
+      case SDL_SCANCODE_LEFT:  view_x_ = std::max(0, view_x_ - kStep); break;
+      case SDL_SCANCODE_RIGHT: view_x_ += kStep; break;
+      case SDL_SCANCODE_UP:    view_y_ = std::max(0, view_y_ - kStep); break;
+      case SDL_SCANCODE_DOWN:  view_y_ += kStep; break;
+      default: break;
+    }
+  }
 
 
   void ai_() {
+    // motion
+    if (start_) {
+      step_();
+    }
+  }
+
+  void step_() {
+    auto alive = [this](int x, int y) { return cells_[index_(x, y)].get_active_state(); };
+    uint64_t births {0};
+    uint64_t deaths {0};
     for (int i = 0; i < w_; ++i) {
       for (int j = 0; j < h_; ++j) {
+        int check_around {live_neighbors(alive, i, j, w_, h_)};
 
-        if (!start_ && cells_[i * w_ + j].get_active_state()) {
-          cells_[i * w_ + j].set_shake({static_cast<float>(Random::get(-1, 1)), static_cast<float>(Random::get(-1, 1))});
+        if (!cells_[index_(i, j)].get_active_state()) {
+          if (check_around == 3) {
+            cells_[index_(i, j)].set_active_change(true);
+            ready_++;
+            births++;
+          }
         } else {
-          cells_[i * w_ + j].set_shake({0.0f, 0.0f});
-        }
-
-        // motion
-        if (start_) {
-          int check_around {0};
-          if (i>0&&j>0 && cells_[(i-1) * w_ + (j-1)].get_active_state() ) { check_around++; }
-          if (j>0 && cells_[i * w_ + (j-1)].get_active_state() ) { check_around++; }
-          if (i<w_&&j>0 && cells_[(i+1) * w_ + (j-1)].get_active_state() ) { check_around++; }
-          if (i<w_ && cells_[(i+1) * w_ + j].get_active_state() ) { check_around++; }
-          if (i<w_&&j<h_ && cells_[(i+1) * w_ + (j+1)].get_active_state() ) { check_around++; }
-          if (j<h_ && cells_[i * w_ + (j+1)].get_active_state() ) { check_around++; }
-          if (i>0&&j<h_ && cells_[(i-1) * w_ + (j+1)].get_active_state() ) { check_around++; }
-          if (i>0 && cells_[(i-1) * w_ + j].get_active_state() ) { check_around++; }
-
-          if (!cells_[i * w_ + j].get_active_state()) {
-            if (check_around == 3) {
-              cells_[i * w_ + j].set_active_change(true);
-              ready_++;
-            }
-          } else {
-            if (check_around < 2 || check_around > 3) {
-              cells_[i * w_ + j].set_active_change(true);
-              ready_--;
-            }
+          if (check_around < 2 || check_around > 3) {
+            cells_[index_(i, j)].set_active_change(true);
+            ready_--;
+            deaths++;
           }
-
         }
-
       }
     }
 
@@ -208,7 +414,8 @@ private:
         cells_[i].set_active_change(false);
       }
     }
-
+    generation_++;
+    series_.push({generation_, static_cast<uint64_t>(ready_), births, deaths});
   }
 
   void draw_cells_() {
@@ -217,28 +424,119 @@ private:
 
     const SDL_Color kWaitColor   {97, 175, 239, 188};
     const SDL_Color kActiveColor {97, 175, 239, 255};
-    
-    for(int i = 0; i < cell_count_; ++i) {
-      SDL_Rect  rect {static_cast<SDL_Rect>(cells_[i].get_shape())};
-      SDL_FRect frect{};
-      SDL_RectToFRect(&rect, &frect);
-      
-      // fill active/wait shape
-      if (cells_[i].get_active_state()) {
-        SDL_SetRenderDrawColor(renderer, kActiveColor.r, kActiveColor.g, kActiveColor.b, kActiveColor.a);
-        CellShake s = cells_[i].get_shake();
-        frect.x += s.x;
-        frect.y += s.y;
-        SDL_RenderFillRect(renderer, &frect);
-      } else if (!start_ && cells_[i].get_wait_state()) {
-        SDL_SetRenderDrawColor(renderer, kWaitColor.r, kWaitColor.g, kWaitColor.b, kWaitColor.a);
-        SDL_RenderFillRect(renderer, &frect);
+
+    // when attached, cell state is read straight out of the shared-memory slot
+    ShmFrame frame;
+    const bool from_ring = attached_ && attached_->latest(frame);
+    if (from_ring) {
+      view_x_ = std::min(view_x_, std::max(0, frame.width - w_));
+      view_y_ = std::min(view_y_, std::max(0, frame.height - h_));
+    }
+
+    // gather first, then one draw call per colour
+    outlines_.clear();
+    filled_.clear();
+    filled_index_.clear();
+    SDL_FRect hover {};
+    bool hovered {false};
+    for (int i = 0; i < w_; ++i) {
+      for (int j = 0; j < h_; ++j) {
+        const Cell &cell = cells_[index_(i, j)];
+        SDL_Rect  rect {static_cast<SDL_Rect>(cell.get_shape())};
+        SDL_FRect frect{};
+        SDL_RectToFRect(&rect, &frect);
+        outlines_.push_back(frect);
+
+        bool active = cell.get_active_state();
+        if (attached_) {
+          const int x = view_x_ + i;
+          const int y = view_y_ + j;
+          active = from_ring && x < frame.width && y < frame.height && frame.get(x, y);
+        }
+
+        if (active) {
+          filled_.push_back(frect);
+          filled_index_.push_back(static_cast<uint32_t>(index_(i, j)));
+        } else if (!start_ && !attached_ && index_(i, j) == hover_) {
+          hover = frect;
+          hovered = true;
+        }
       }
+    }
 
-      // draw shape
-      SDL_SetRenderDrawColor(renderer, origin_color.r, origin_color.g, origin_color.b, origin_color.a);
-      SDL_RenderRect(renderer, &frect);
+    // the writer may have lapped the ring while the cells were read, and then
+    // they mix two generations; draw the last intact frame instead, as when
+    // no slot was complete at all
+    if (attached_) {
+      if (from_ring && ShmRingReader::still_valid(frame)) {
+        ring_filled_ = filled_;
+      } else {
+        filled_ = ring_filled_;
+      }
     }
+
+    // paused cells shake; running or mirrored ones hold still
+    if (!start_ && !attached_) {
+      const size_t n = filled_index_.size();
+      shake_.resize(n * 2);
+      const uint32_t *index = filled_index_.data();
+      float *shake = shake_.data();
+      const uint32_t frame_no = shake_frame_;
+      for (size_t k = 0; k < n; ++k) {
+        const uint32_t h = shake_hash(index[k], frame_no);
+        shake[2 * k]     = static_cast<float>(shake_offset(h & 0xffffu));
+        shake[2 * k + 1] = static_cast<float>(shake_offset(h >> 16));
+      }
+      for (size_t k = 0; k < n; ++k) {
+        filled_[k].x += shake[2 * k];
+        filled_[k].y += shake[2 * k + 1];
+      }
+    }
+
+    SDL_SetRenderDrawColor(renderer, kActiveColor.r, kActiveColor.g, kActiveColor.b, kActiveColor.a);
+    SDL_RenderFillRects(renderer, filled_.data(), static_cast<int>(filled_.size()));
+    if (hovered) {
+      SDL_SetRenderDrawColor(renderer, kWaitColor.r, kWaitColor.g, kWaitColor.b, kWaitColor.a);
+      SDL_RenderFillRect(renderer, &hover);
+    }
+    SDL_SetRenderDrawColor(renderer, origin_color.r, origin_color.g, origin_color.b, origin_color.a);
+    SDL_RenderRects(renderer, outlines_.data(), static_cast<int>(outlines_.size()));
+    ++shake_frame_;
+  }
+
+  // Sparkline of the population along the bottom edge, newest on the right,
+  // scaled to the largest population shown, with the latest numbers above it.
+  void draw_series_() {
+    const float kPlotH = 24.0f;
+    const float kMargin = 4.0f;
+    int out_w {}, out_h {};
+    SDL_GetRenderOutputSize(renderer, &out_w, &out_h);
+    const float w = out_w / scale_x_ - 2 * kMargin;
+    const float bottom = out_h / scale_y_ - kMargin;
+    if (w < 2) { return; }
+
+    plot_.clear();
+    series_.read(plot_, static_cast<size_t>(w));
+    if (plot_.size() < 2) { return; }
+    uint64_t top {1};
+    for (const SeriesSample &s : plot_) { top = std::max(top, s.population); }
+
+    std::vector<SDL_FPoint> line(plot_.size());
+    const float dx = w / static_cast<float>(std::max<size_t>(plot_.size() - 1, 1));
+    for (size_t i = 0; i < plot_.size(); ++i) {
+      line[i] = {kMargin + dx * i, bottom - kPlotH * static_cast<float>(plot_[i].population) / static_cast<float>(top)};
+    }
+
+    SDL_Color origin_color;
+    SDL_GetRenderDrawColor(renderer, &origin_color.r, &origin_color.g, &origin_color.b, &origin_color.a);
+    SDL_SetRenderDrawColor(renderer, 229, 192, 123, 220);
+    SDL_RenderLines(renderer, line.data(), static_cast<int>(line.size()));
+    const SeriesSample &last = plot_.back();
+    SDL_RenderDebugTextFormat(renderer, kMargin, bottom - kPlotH - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE - 2,
+                              "gen %llu  pop %llu  +%llu -%llu", static_cast<unsigned long long>(last.generation),
+                              static_cast<unsigned long long>(last.population),
+                              static_cast<unsigned long long>(last.births), static_cast<unsigned long long>(last.deaths));
+    SDL_SetRenderDrawColor(renderer, origin_color.r, origin_color.g, origin_color.b, origin_color.a);
   }
 
   void update_() {
@@ -257,11 +555,14 @@ private:
 
   void init_cells_() {
     SDL_Point start_pos;
-    const int kGap = 2;  // pixels
 
     int window_w {};
     int window_h {};
-    SDL_GetWindowSize(window, &window_w, &window_h);
+    if (window) {
+      SDL_GetWindowSize(window, &window_w, &window_h);
+    } else {
+      SDL_GetRenderOutputSize(renderer, &window_w, &window_h);  // offscreen
+    }
     window_w /= scale_x_;
     window_h /= scale_y_;
 
@@ -284,13 +585,15 @@ private:
     }
 
     cell_count_ = w_ * h_;
+    origin_ = start_pos;
+    hover_ = -1;
+    edits_.clear();
 
     assert(cell_count_ <= MAX_CELL_COUNT && "cell_count_ > max limit");
 
     for (int i = 0; i < w_; ++i) {
       for (int j = 0; j < h_; ++j) {
-        cells_[i * w_ + j].set_shape({start_pos.x + i*(side_+kGap), start_pos.y + j*(side_+kGap), side_, side_})
-                          .set_wait_state(false)
+        cells_[index_(i, j)].set_shape({start_pos.x + i*(side_+kGap), start_pos.y + j*(side_+kGap), side_, side_})
                           .set_active_state(false)
                           .set_active_change(false);
       }
@@ -301,17 +604,616 @@ private:
 
 std::unique_ptr<CellGrand> gCG;
 
+// Command line. With no arguments the interactive window is opened.
+//   --run            step a soup headless as fast as possible
+//   --shards N       step a soup headless, split across N worker processes
+//   --size WxH       board size for headless modes
+//   --gens N         generations to run (--run: <= 0 runs until killed)
+//   --seed N         soup seed
+//   --density P      percent of live cells in the soup
+//   --threads N      with --run, step fixed row bands on N workers pinned per NUMA node
+//                    (default 0: the build's parallel_for backend; 1: one thread)
+//   --block K        with --run, advance K generations per cache-sized tile pass
+//   --sparse         with --run, step only cells next to last generation's changes
+//                    (for mostly empty boards; ignores --block and --threads)
+//   --verify         compare shards against a single-process run every generation
+//   --publish NAME   with --run, publish frames to shared memory NAME
+//   --attach NAME    open the window as a read-only viewer of NAME
+//   --control EP     accept scripted commands on EP (unix:PATH or tcp:PORT)
+//   --log-every N    with --run, log population and hash every N generations
+//   --stop-static N  with --run, stop once the board is unchanged across N generations
+//   --record FILE    with --run, append "generation,population,hash" lines to FILE
+//   --record-every N record every N generations (default 1)
+//   --checkpoint-dir DIR   with --run, save crash-safe checkpoints into DIR
+//   --checkpoint-every N   checkpoint every N generations
+//   --checkpoint-secs T    checkpoint every T seconds
+//   --restore DIR    with --run, resume from the newest valid checkpoint in DIR
+//   --frames DIR     with --run, write PNG frames into DIR
+//   --frames-pipe CMD  with --run, pipe raw rgb24 frames into CMD's stdin
+//   --frames-every N   export every N generations (default 1)
+//   --frames-scale S   pixels per cell (default 4)
+//   --frames-region X,Y,W,H  export only these cells
+//   --offscreen WxH  render into an offscreen surface with the software renderer
+//   --pattern FILE   with --offscreen, RLE pattern to load (centered)
+//   --render-steps N with --offscreen, generations to advance before rendering
+//   --render-frames N  frames to render and time (default 1)
+//   --snapshot FILE  with --offscreen, save the last frame as BMP
+//   --golden FILE    with --offscreen, compare the last frame with a BMP
+//   --tolerance N    per-channel difference still counted as equal (default 8)
+//   --max-diff P     percent of pixels allowed to differ (default 0)
+//   --diff FILE      save the frame with differing pixels in red
+//   --selftest       check every engine against a per-cell reference and exit
+//   --bench          time the hot paths on a --size soup for --gens generations
+//   --analyze FILE   report period, displacement and velocity of an RLE pattern
+//   --soups N        run N random soups (--seed, --density) on the bit-sliced batch
+//                    engine until they settle, and count the outcomes
+//   --soup-size WxH  soup size (default 16x16)
+//   --soup-gens N    give up on a soup after N generations (default 2000)
+//   --rule RULE      with --soups, the rule in B3/S23 notation (default Conway)
+//   --lanes N        boards per batch: 64, 128, 256 or 512 (default 512)
+//   --sweep FILE     run every rule on --sweep-soups soups (--seed, --density), classify
+//                    each as dying, stable, oscillating, exploding or chaotic, and write
+//                    the table to FILE (see rule_sweep.h)
+//   --sweep-require RULE  sweep only rules with all of these bits, e.g. B3/S
+//   --sweep-exclude RULE  and none of these, e.g. B0/S to leave out B0 rules
+//   --sweep-soups N  soups per rule (default 4, at most 255)
+//   --sweep-gens N   generations before a soup still moving is classified (default 256)
+//   --sweep-size N   board side (default 32; soups fill the middle half)
+//
+// AUTO_CELL_ISA=generic|sse4.2|avx2|avx512 caps the CPU kernel tier picked at startup.
+struct AppOptions {
+  bool            headless {false};
+  bool            sharded {false};
+  int             shards {2};
+  bool            verify {false};
+  HeadlessOptions run;
+  const char     *attach {nullptr};
+  const char     *control {nullptr};
+  int             log_every {0};
+  int             stop_static {0};
+  const char     *record {nullptr};
+  int             record_every {1};
+  const char     *checkpoint_dir {nullptr};
+  int             checkpoint_every {0};
+  double          checkpoint_secs {0};
+  const char     *frames {nullptr};
+  const char     *frames_pipe {nullptr};
+  int             frames_every {1};
+  FrameStyle      frame_style;
+  FrameRegion     frame_region;
+  bool            offscreen {false};
+  int             offscreen_w {800};
+  int             offscreen_h {600};
+  const char     *pattern {nullptr};
+  int             render_steps {0};
+  int             render_frames {1};
+  const char     *snapshot {nullptr};
+  const char     *golden {nullptr};
+  int             tolerance {8};
+  double          max_diff {0};
+  const char     *diff {nullptr};
+  bool            selftest {false};
+  bool            bench {false};
+  const char     *analyze {nullptr};
+  bool            soups {false};
+  SoupOptions     soup;
+  SweepOptions    sweep;
+};
+
+static bool parse_options(int argc, char *argv[], AppOptions &opt) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (SDL_strcmp(arg, "--verify") == 0) {
+      opt.verify = true;
+      continue;
+    }
+    if (SDL_strcmp(arg, "--run") == 0) {
+      opt.headless = true;
+      continue;
+    }
+    if (SDL_strcmp(arg, "--sparse") == 0) {
+      opt.run.sparse = true;
+      continue;
+    }
+    if (SDL_strcmp(arg, "--selftest") == 0) {
+      opt.selftest = true;
+      continue;
+    }
+    if (SDL_strcmp(arg, "--bench") == 0) {
+      opt.bench = true;
+      continue;
+    }
+    if (!val) {
+      SDL_Log("unknown or incomplete option: %s", arg);
+      return false;
+    }
+    ++i;
+    if (SDL_strcmp(arg, "--shards") == 0) {
+      opt.sharded = true;
+      opt.shards = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--size") == 0) {
+      if (SDL_sscanf(val, "%dx%d", &opt.run.width, &opt.run.height) != 2) {
+        SDL_Log("--size expects WxH, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--gens") == 0) {
+      opt.run.generations = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--seed") == 0) {
+      opt.run.seed = SDL_strtoull(val, nullptr, 0);
+    } else if (SDL_strcmp(arg, "--density") == 0) {
+      opt.run.density = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--threads") == 0) {
+      opt.run.threads = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--block") == 0) {
+      opt.run.block = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--publish") == 0) {
+      opt.run.publish = val;
+    } else if (SDL_strcmp(arg, "--attach") == 0) {
+      opt.attach = val;
+    } else if (SDL_strcmp(arg, "--control") == 0) {
+      opt.control = val;
+    } else if (SDL_strcmp(arg, "--log-every") == 0) {
+      opt.log_every = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--stop-static") == 0) {
+      opt.stop_static = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--record") == 0) {
+      opt.record = val;
+    } else if (SDL_strcmp(arg, "--record-every") == 0) {
+      opt.record_every = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--checkpoint-dir") == 0) {
+      opt.checkpoint_dir = val;
+    } else if (SDL_strcmp(arg, "--checkpoint-every") == 0) {
+      opt.checkpoint_every = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--checkpoint-secs") == 0) {
+      opt.checkpoint_secs = SDL_atof(val);
+    } else if (SDL_strcmp(arg, "--restore") == 0) {
+      opt.run.restore = val;
+    } else if (SDL_strcmp(arg, "--frames") == 0) {
+      opt.frames = val;
+    } else if (SDL_strcmp(arg, "--frames-pipe") == 0) {
+      opt.frames_pipe = val;
+    } else if (SDL_strcmp(arg, "--frames-every") == 0) {
+      opt.frames_every = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--frames-scale") == 0) {
+      opt.frame_style.scale = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--frames-region") == 0) {
+      FrameRegion &r = opt.frame_region;
+      if (SDL_sscanf(val, "%d,%d,%d,%d", &r.x, &r.y, &r.w, &r.h) != 4) {
+        SDL_Log("--frames-region expects X,Y,W,H, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--analyze") == 0) {
+      opt.analyze = val;
+    } else if (SDL_strcmp(arg, "--offscreen") == 0) {
+      opt.offscreen = true;
+      if (SDL_sscanf(val, "%dx%d", &opt.offscreen_w, &opt.offscreen_h) != 2 || opt.offscreen_w < 1 || opt.offscreen_h < 1) {
+        SDL_Log("--offscreen expects WxH, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--pattern") == 0) {
+      opt.pattern = val;
+    } else if (SDL_strcmp(arg, "--render-steps") == 0) {
+      opt.render_steps = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--render-frames") == 0) {
+      opt.render_frames = SDL_max(SDL_atoi(val), 1);
+    } else if (SDL_strcmp(arg, "--snapshot") == 0) {
+      opt.snapshot = val;
+    } else if (SDL_strcmp(arg, "--golden") == 0) {
+      opt.golden = val;
+    } else if (SDL_strcmp(arg, "--tolerance") == 0) {
+      opt.tolerance = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--max-diff") == 0) {
+      opt.max_diff = SDL_atof(val);
+    } else if (SDL_strcmp(arg, "--diff") == 0) {
+      opt.diff = val;
+    } else if (SDL_strcmp(arg, "--soups") == 0) {
+      opt.soups = true;
+      opt.soup.soups = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--soup-size") == 0) {
+      if (SDL_sscanf(val, "%dx%d", &opt.soup.width, &opt.soup.height) != 2) {
+        SDL_Log("--soup-size expects WxH, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--soup-gens") == 0) {
+      opt.soup.max_generations = SDL_strtoull(val, nullptr, 0);
+    } else if (SDL_strcmp(arg, "--rule") == 0) {
+      if (!parse_rule(val, opt.soup.rule)) {
+        SDL_Log("--rule expects B3/S23 notation, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--lanes") == 0) {
+      const int lanes = SDL_atoi(val);
+      if (lanes != 64 && lanes != 128 && lanes != 256 && lanes != 512) {
+        SDL_Log("--lanes expects 64, 128, 256 or 512, got %s", val);
+        return false;
+      }
+      opt.soup.words = lanes / 64;
+    } else if (SDL_strcmp(arg, "--sweep") == 0) {
+      opt.sweep.path = val;
+    } else if (SDL_strcmp(arg, "--sweep-require") == 0) {
+      if (!parse_rule(val, opt.sweep.require)) {
+        SDL_Log("--sweep-require expects B3/S23 notation, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--sweep-exclude") == 0) {
+      if (!parse_rule(val, opt.sweep.exclude)) {
+        SDL_Log("--sweep-exclude expects B3/S23 notation, got %s", val);
+        return false;
+      }
+    } else if (SDL_strcmp(arg, "--sweep-soups") == 0) {
+      opt.sweep.soups = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--sweep-gens") == 0) {
+      opt.sweep.generations = SDL_atoi(val);
+    } else if (SDL_strcmp(arg, "--sweep-size") == 0) {
+      opt.sweep.size = SDL_atoi(val);
+    } else {
+      SDL_Log("unknown option: %s", arg);
+      return false;
+    }
+  }
+  return true;
+}
+
+static ShmRingReader gViewRing;
+static ControlServer gControl;
+static HookRegistry gHooks;
+static std::unique_ptr<AsyncIo::Stream> gRecording;
+static FramePipe gFramePipe;
+static constexpr int kMaxQueuedFrames = 8;  // --frames PNGs waiting on the I/O thread
+
+// Hooks selectable from the command line; embedders add their own to gHooks.
+static bool add_builtin_hooks(const AppOptions &opt) {
+  if (opt.log_every > 0) {
+    gHooks.add(static_cast<uint64_t>(opt.log_every), [](const BoardView &view, HookActions &) {
+      SDL_Log("generation %llu: population %llu, hash %016llx",
+              static_cast<unsigned long long>(view.generation),
+              static_cast<unsigned long long>(view.population()),
+              static_cast<unsigned long long>(view.hash()));
+    });
+  }
+  if (opt.stop_static > 0) {
+    gHooks.add(static_cast<uint64_t>(opt.stop_static), [last = uint64_t {0}](const BoardView &view, HookActions &actions) mutable {
+      uint64_t h = view.hash();
+      if (h == last) {
+        SDL_Log("board unchanged at generation %llu, stopping", static_cast<unsigned long long>(view.generation));
+        actions.stop();
+      }
+      last = h;
+    });
+  }
+  if (opt.record) {
+    gRecording = std::make_unique<AsyncIo::Stream>(gIo, opt.record);
+    gHooks.add(static_cast<uint64_t>(opt.record_every), [](const BoardView &view, HookActions &) {
+      char line[96];
+      int n = SDL_snprintf(line, sizeof(line), "%llu,%llu,%016llx\n",
+                           static_cast<unsigned long long>(view.generation),
+                           static_cast<unsigned long long>(view.population()),
+                           static_cast<unsigned long long>(view.hash()));
+      gRecording->append(line, static_cast<size_t>(n));
+    });
+  }
+  if (opt.frames || opt.frames_pipe) {
+    if (opt.frames) {
+      std::error_code ec;
+      std::filesystem::create_directories(opt.frames, ec);
+    }
+    if (opt.frames_pipe && !gFramePipe.open(opt.frames_pipe)) { return false; }
+    const std::string dir {opt.frames ? opt.frames : ""};
+    const FrameStyle style {opt.frame_style};
+    const FrameRegion region {opt.frame_region};
+    // PNGs are encoded and written on the I/O thread from a copy of the rows;
+    // the hook waits for a free slot once kMaxQueuedFrames are outstanding
+    auto backlog = std::make_shared<FrameBacklog>(kMaxQueuedFrames);
+    gHooks.add(static_cast<uint64_t>(opt.frames_every), [dir, style, region, backlog](const BoardView &view, HookActions &actions) {
+      if (gFramePipe.is_open() && !gFramePipe.write(view, region, style)) {
+        actions.stop();
+      }
+      if (!dir.empty()) {
+        backlog->acquire();
+        auto rows = std::make_shared<FrameRows>();
+        if (!copy_frame_rows(view, region, style, *rows)) {
+          backlog->release();
+          SDL_Log("frames: region is empty or too large at scale %d", style.scale);
+          actions.stop();
+          return;
+        }
+        char name[40];
+        SDL_snprintf(name, sizeof(name), "frame-%012llu.png", static_cast<unsigned long long>(view.generation));
+        gIo.write_file_with((std::filesystem::path(dir) / name).string(), [rows, style, backlog] {
+          std::vector<char> png = encode_png(rows->view, rows->region, style);
+          rows->bits = {};
+          backlog->release();
+          return png;
+        });
+      }
+    });
+  }
+  return true;
+}
+
+/* Draws the title and the board; shared by the window and the offscreen path. */
+static bool render_frame()
+{
+    const char *message = "Auto Cell";
+    int w = 0, h = 0;
+    float x, y;
+    const float scale = 2.0f;
+
+    /* Center the message and scale it up */
+    SDL_GetRenderOutputSize(renderer, &w, &h);
+    SDL_SetRenderScale(renderer, scale, scale);
+    x = ((w / scale) - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE * SDL_strlen(message)) / 2;
+    // y = ((h / scale) - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE) / 2;
+    y = 10.0f;
+
+    /* Draw the message */
+    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
+    SDL_RenderClear(renderer);
+    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 127);
+    SDL_RenderDebugText(renderer, x, y, message);
+    return gCG->play();
+}
+
+// Renders frames into a surface through the software renderer, with the dummy
+// video driver, so the drawing code runs and can be checked without a GPU or
+// a display. The board is loaded from --pattern and advanced --render-steps
+// generations; the last of --render-frames frames is saved and/or compared.
+static SDL_Surface *open_offscreen(int w, int h)
+{
+    SDL_SetHint(SDL_HINT_VIDEO_DRIVER, "dummy");
+    if (!SDL_Init(SDL_INIT_VIDEO)) {
+        SDL_Log("offscreen: cannot init video: %s", SDL_GetError());
+        return NULL;
+    }
+    SDL_Surface *target = SDL_CreateSurface(w, h, SDL_PIXELFORMAT_RGBA32);
+    renderer = target ? SDL_CreateSoftwareRenderer(target) : NULL;
+    if (!renderer) {
+        SDL_Log("offscreen: cannot create software renderer: %s", SDL_GetError());
+        SDL_DestroySurface(target);
+        return NULL;
+    }
+    SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    return target;
+}
+
+static void close_offscreen(SDL_Surface *target)
+{
+    SDL_DestroyRenderer(renderer);
+    renderer = NULL;
+    SDL_DestroySurface(target);
+}
+
+static int run_analyze(const char *path)
+{
+    size_t size {0};
+    void *data = SDL_LoadFile(path, &size);
+    LifeBoard pattern;
+    Rule rule;
+    std::string error;
+    const bool loaded = data != nullptr;
+    const bool ok = loaded && parse_rle(static_cast<const char *>(data), size, pattern, &rule, &error);
+    SDL_free(data);
+    if (!ok) {
+        SDL_Log("analyze: cannot load %s: %s", path, loaded ? error.c_str() : SDL_GetError());
+        return 1;
+    }
+    char rule_text[24];
+    format_rule(rule, rule_text);
+    if (rule.birth & 1u) {
+        SDL_Log("analyze: %s: B0 rules grow without bound", rule_text);
+        return 1;
+    }
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const PatternAnalysis a = analyze_pattern(pattern, rule);
+    const double ms = 1000.0 * static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+    SDL_Log("analyze: %s (%s): %s, %.3f ms", path, rule_text, format_analysis(a).c_str(), ms);
+    return a.kind == PatternAnalysis::Kind::kUnknown ? 1 : 0;
+}
+
+static int run_offscreen(const AppOptions &opt)
+{
+    SDL_Surface *target = open_offscreen(opt.offscreen_w, opt.offscreen_h);
+    if (!target) {
+        return 1;
+    }
+
+    gCG = std::make_unique<CellGrand>(8, 25, 25);
+    render_frame();  // first frame sets the render scale and lays out the grid
+
+    int rc {0};
+    if (opt.pattern) {
+        size_t size {0};
+        void *data = SDL_LoadFile(opt.pattern, &size);
+        LifeBoard pattern;
+        std::string error;
+        if (!data || !parse_rle(static_cast<const char *>(data), size, pattern, nullptr, &error)) {
+            SDL_Log("offscreen: cannot load %s: %s", opt.pattern, data ? error.c_str() : SDL_GetError());
+            rc = 1;
+        } else {
+            gCG->load_board(pattern);
+        }
+        SDL_free(data);
+    }
+    gCG->step(opt.render_steps);
+
+    const Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < opt.render_frames; ++i) {
+        // idle cells shake with the frame number; pinning it makes every frame the same
+        gCG->set_shake_frame(static_cast<uint32_t>(opt.run.seed));
+        render_frame();
+    }
+    const double ms = static_cast<double>(SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    SDL_Log("offscreen: %dx%d, %d frames, %.3f ms/frame", opt.offscreen_w, opt.offscreen_h,
+            opt.render_frames, ms / SDL_max(opt.render_frames, 1));
+
+    SDL_Surface *shot = SDL_RenderReadPixels(renderer, NULL);
+    if (!shot) {
+        SDL_Log("offscreen: cannot read pixels: %s", SDL_GetError());
+        rc = 1;
+    }
+    if (shot && opt.snapshot && !SDL_SaveBMP(shot, opt.snapshot)) {
+        SDL_Log("offscreen: cannot save %s: %s", opt.snapshot, SDL_GetError());
+        rc = 1;
+    }
+    if (shot && opt.golden) {
+        SDL_Surface *golden = SDL_LoadBMP(opt.golden);
+        SDL_Surface *marked = NULL;
+        ImageDiff diff;
+        if (!diff_images(shot, golden, opt.tolerance, diff, opt.diff ? &marked : nullptr)) {
+            SDL_Log("offscreen: cannot compare with %s (missing or different size)", opt.golden);
+            rc = 1;
+        } else {
+            const double percent = 100.0 * static_cast<double>(diff.differing) / (static_cast<double>(diff.width) * diff.height);
+            const bool pass = percent <= opt.max_diff;
+            SDL_Log("offscreen: %s: %llu pixels differ (%.3f%%, max channel delta %d, tolerance %d) - %s",
+                    opt.golden, static_cast<unsigned long long>(diff.differing), percent,
+                    diff.max_delta, opt.tolerance, pass ? "pass" : "FAIL");
+            if (marked && diff.differing > 0) { SDL_SaveBMP(marked, opt.diff); }
+            rc = pass ? rc : 1;
+        }
+        SDL_DestroySurface(marked);
+        SDL_DestroySurface(golden);
+    }
+
+    SDL_DestroySurface(shot);
+    gCG.reset();
+    close_offscreen(target);
+    return rc;
+}
+
+// --selftest: the LifeBoard engines plus the window's own per-cell stepper,
+// which runs on an offscreen grid sized to each board it can hold.
+static int run_selftest_all()
+{
+    SDL_Surface *target = open_offscreen(800, 600);
+    if (!target) {
+        return 1;
+    }
+    const SelftestEngine window_engine {
+        "window",
+        [](const LifeBoard &b, const Rule &r) { return r == Rule {} && b.get_w() <= 25 && b.get_h() <= 25; },
+        [](LifeBoard &b, const Rule &, int n) {
+            auto grid = std::make_unique<CellGrand>(8, b.get_w(), b.get_h());
+            if (grid->board_w() != b.get_w() || grid->board_h() != b.get_h()) {
+                b = LifeBoard(1, 1);  // reported as a size mismatch
+                return;
+            }
+            for (int y = 0; y < b.get_h(); ++y) {
+                for (int x = 0; x < b.get_w(); ++x) { grid->set_cell(x, y, b.get(x, y)); }
+            }
+            grid->step(n);
+            b = grid->to_board();
+        }};
+    const int failures = run_selftest({window_engine});
+    close_offscreen(target);
+    return failures == 0 ? 0 : 1;
+}
+
 /* This function runs once at startup. */
 SDL_AppResult SDL_AppInit(void **appstate, int argc, char *argv[])
 {
+    AppOptions options;
+    if (!parse_options(argc, argv, options)) {
+        return SDL_APP_FAILURE;
+    }
+    const char *isa = SDL_getenv("AUTO_CELL_ISA");
+    if (isa && SDL_strcmp(isa, cpu_kernels().name) != 0) {
+        SDL_Log("cpu: AUTO_CELL_ISA=%s not available, using %s kernels", isa, cpu_kernels().name);
+    } else {
+        SDL_Log("cpu: using %s kernels%s", cpu_kernels().name, isa ? " (AUTO_CELL_ISA)" : "");
+    }
+    if (options.sharded) {
+        ShardOptions shard;
+        shard.width       = options.run.width;
+        shard.height      = options.run.height;
+        shard.shards      = options.shards;
+        shard.generations = options.run.generations;
+        shard.seed        = options.run.seed;
+        shard.density     = options.run.density;
+        shard.verify      = options.verify;
+        return run_sharded(shard) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.headless) {
+        gIo.start();
+        if (!add_builtin_hooks(options)) {
+            gIo.stop();
+            return SDL_APP_FAILURE;
+        }
+        options.run.hooks = &gHooks;
+        std::unique_ptr<Checkpointer> checkpoints;
+        if (options.checkpoint_dir) {
+            // a directory alone still gets the final checkpoint; default to once a minute
+            double secs = options.checkpoint_every <= 0 && options.checkpoint_secs <= 0 ? 60.0 : options.checkpoint_secs;
+            checkpoints = std::make_unique<Checkpointer>(gIo, options.checkpoint_dir,
+                                                         static_cast<uint64_t>(SDL_max(options.checkpoint_every, 0)), secs);
+            options.run.checkpoints = checkpoints.get();
+        }
+        int rc = run_headless(options.run);
+        checkpoints.reset();
+        gFramePipe.close();
+        gRecording.reset();
+        gIo.stop();
+        return rc == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.selftest) {
+        return run_selftest_all() == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.bench) {
+        BenchOptions bench;
+        bench.width       = options.run.width;
+        bench.height      = options.run.height;
+        bench.generations = options.run.generations;
+        bench.seed        = options.run.seed;
+        bench.density     = options.run.density;
+        return run_bench(bench) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.analyze) {
+        return run_analyze(options.analyze) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.soups) {
+        options.soup.seed    = options.run.seed;
+        options.soup.density = options.run.density;
+        return run_soups(options.soup) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.sweep.path) {
+        options.sweep.seed    = options.run.seed;
+        options.sweep.density = options.run.density;
+        options.sweep.words   = options.soup.words;
+        return run_sweep(options.sweep, gIo) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.offscreen) {
+        return run_offscreen(options) == 0 ? SDL_APP_SUCCESS : SDL_APP_FAILURE;
+    }
+    if (options.attach && !gViewRing.open(options.attach)) {
+        return SDL_APP_FAILURE;
+    }
+    if (options.control && !gControl.listen(options.control)) {
+        return SDL_APP_FAILURE;
+    }
+
     /* Create the window */
     if (!SDL_CreateWindowAndRenderer("Auto Cell", 800, 600, SDL_WINDOW_RESIZABLE, &window, &renderer)) {
         SDL_Log("Couldn't create window and renderer: %s", SDL_GetError());
         return SDL_APP_FAILURE;
     }
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    SDL_SetRenderVSync(renderer, 1);
+    /* finished I/O wakes an idle SDL_AppIterate; see wait_for_work() */
+    gWakeEvent = SDL_RegisterEvents(1);
+    if (gWakeEvent) {
+        gIo.set_on_complete([] {
+            SDL_Event e {};
+            e.type = gWakeEvent;
+            SDL_PushEvent(&e);
+        });
+    }
+    gIo.start();
 
     gCG = std::make_unique<CellGrand>(8, 25, 25);
+    if (options.attach) {
+        gCG->attach(&gViewRing);
+    }
     return SDL_APP_CONTINUE;
 }
 
@@ -328,18 +1230,30 @@ SDL_AppResult SDL_AppEvent(void *appstate, SDL_Event *event)
       }
     }
 
-    gCG->handle_input(event);
+    /* the board only changes in SDL_AppIterate; see input_queue.h */
+    gInput.push(*event);
     return SDL_APP_CONTINUE;
 }
 
+/* Main-thread time each frame gets to spend on background tasks. */
+static constexpr double kTaskBudgetMs = 4.0;
+
+/* How long an idle frame sleeps when nothing can wake it with an event:
+   control clients and an attached headless run are polled, the rest is a
+   safety net. */
+static constexpr Sint32 kPollWaitMs = 20;
+static constexpr Sint32 kIdleWaitMs = 1000;
+
+/* Blocks until an event arrives or timeout_ms passes. The event stays queued
+   for SDL to hand to SDL_AppEvent before the next SDL_AppIterate. */
+static void wait_for_work(Sint32 timeout_ms)
+{
+    SDL_WaitEventTimeout(nullptr, timeout_ms);
+}
+
 /* This function runs once per frame, and is the heart of the program. */
 SDL_AppResult SDL_AppIterate(void *appstate)
 {
-    const char *message = "Auto Cell";
-    int w = 0, h = 0;
-    float x, y;
-    const float scale = 2.0f;
-
     const int FPS = 2; // expect fps
     const float frameTime = 1.0f / FPS;
     Uint64 startTicks;
@@ -347,25 +1261,44 @@ SDL_AppResult SDL_AppIterate(void *appstate)
     Uint64 frequency = SDL_GetPerformanceFrequency();
 
     startTicks = SDL_GetPerformanceCounter();
-    /* Center the message and scale it up */
-    SDL_GetRenderOutputSize(renderer, &w, &h);
-    SDL_SetRenderScale(renderer, scale, scale);
-    x = ((w / scale) - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE * SDL_strlen(message)) / 2;
-    // y = ((h / scale) - SDL_DEBUG_TEXT_FONT_CHARACTER_SIZE) / 2;
-    y = 10.0f;
+    static InputBatch input;
+    static bool first_frame {true};
+    gInput.take(input);
+    bool dirty = gCG->apply_input(input) || input.woke || first_frame;
+    first_frame = false;
+    dirty |= gIo.poll_completions() > 0;
+    dirty |= gControl.poll(*gCG);
+    if (gTasks.runnable()) {
+        gTasks.run(kTaskBudgetMs);
+        dirty = true;
+    }
 
-    /* Draw the message */
-    SDL_SetRenderDrawColor(renderer, 0, 0, 0, 255);
-    SDL_RenderClear(renderer);
-    SDL_SetRenderDrawColor(renderer, 255, 255, 255, 127);
-    SDL_RenderDebugText(renderer, x, y, message);
-    bool status = gCG->play();
+    /* paused with nothing to do: sleep until input, I/O or a poll is due */
+    if (!dirty && !gCG->running() && !gCG->attached()) {
+        if (!gTasks.runnable() && !gControl.busy()) {
+            wait_for_work(gControl.is_listening() ? kPollWaitMs : kIdleWaitMs);
+        }
+        return SDL_APP_CONTINUE;
+    }
+
+    bool status = render_frame();
     SDL_RenderPresent(renderer);
 
     frameTicks = SDL_GetPerformanceCounter() - startTicks;
     float deltaTime = static_cast<float>(frameTicks) / frequency;
     if (status && deltaTime < frameTime) {
-      SDL_Delay(static_cast<Uint32>((frameTime - deltaTime) * 1000.0f));
+      // time left before the next frame goes to tasks before sleeping
+      if (!gTasks.idle()) {
+        gTasks.run((frameTime - deltaTime) * 1000.0f);
+        frameTicks = SDL_GetPerformanceCounter() - startTicks;
+        deltaTime = static_cast<float>(frameTicks) / frequency;
+      }
+      if (deltaTime < frameTime) {
+        SDL_Delay(static_cast<Uint32>((frameTime - deltaTime) * 1000.0f));
+      }
+    }
+    if (!status && gCG->attached()) {
+      wait_for_work(kPollWaitMs);  // new frames from the headless run are polled
     }
 
     return SDL_APP_CONTINUE;
@@ -374,4 +1307,7 @@ SDL_AppResult SDL_AppIterate(void *appstate)
 /* This function runs once at shutdown. */
 void SDL_AppQuit(void *appstate, SDL_AppResult result)
 {
+    /* let pending saves land before the process exits */
+    gIo.stop();
+    gTasks.clear();
 }
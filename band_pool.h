@@ -0,0 +1,190 @@
+#pragma once
+// Persistent worker threads that each own one fixed band of rows, for
+// stepping large boards on multi-socket machines.
+//
+// Workers are spread over the NUMA nodes in proportion to their CPUs and
+// pinned to their node's CPUs; consecutive workers share a node, so each node
+// owns one contiguous block of rows. place() has every worker zero its own
+// band of a LifeBoard::Untouched board, and since that is the first write
+// to those pages the kernel backs them with memory on the worker's node.
+// Bands never move between generations, so every step reads and writes
+// node-local memory except for the single halo row at each band edge.
+//
+// Topology comes from /sys/devices/system/node on Linux. Elsewhere, or
+// without that directory, the pool runs as one node and doesn't pin.
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "life_board.h"
+#include "parallel.h"
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+struct NumaNode {
+  int id {0};
+  std::vector<int> cpus;
+};
+
+// Parses a sysfs cpu or node list such as "0-3,8-11".
+inline std::vector<int> parse_cpulist(const char *text) {
+  std::vector<int> cpus;
+  while (*text) {
+    char *end {nullptr};
+    long lo = std::strtol(text, &end, 10);
+    if (end == text) { break; }
+    long hi = lo;
+    if (*end == '-') {
+      const char *p = end + 1;
+      hi = std::strtol(p, &end, 10);
+      if (end == p) { break; }
+    }
+    for (long c = lo; c <= hi && c < 4096; ++c) { cpus.push_back(static_cast<int>(c)); }
+    text = *end == ',' ? end + 1 : end;
+    if (*end != ',') { break; }
+  }
+  return cpus;
+}
+
+#ifdef __linux__
+// First line of a small sysfs file, or "" if it can't be read.
+inline std::string read_sysfs_line(const std::string &path) {
+  char line[4096] {};
+  FILE *f = std::fopen(path.c_str(), "r");
+  if (!f) { return {}; }
+  const bool ok = std::fgets(line, sizeof(line), f) != nullptr;
+  std::fclose(f);
+  return ok ? line : "";
+}
+#endif
+
+// Nodes that have CPUs this process may run on, lowest id first.
+inline std::vector<NumaNode> numa_nodes() {
+  std::vector<NumaNode> nodes;
+#ifdef __linux__
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) { return nodes; }
+  const std::string root = "/sys/devices/system/node/";
+  for (int id : parse_cpulist(read_sysfs_line(root + "online").c_str())) {
+    NumaNode node {id, {}};
+    for (int cpu : parse_cpulist(read_sysfs_line(root + "node" + std::to_string(id) + "/cpulist").c_str())) {
+      if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) { node.cpus.push_back(cpu); }
+    }
+    if (!node.cpus.empty()) { nodes.push_back(std::move(node)); }
+  }
+#endif
+  return nodes;
+}
+
+class BandPool {
+public:
+  // Splits rows [0, height) into bands for `threads` workers (0 = one per CPU).
+  BandPool(int height, int threads = 0) : nodes_{numa_nodes()} {
+    int n = threads > 0 ? threads : worker_count();
+    n = std::max(1, std::min(n, height));
+    if (nodes_.empty()) { nodes_.push_back({0, {}}); }
+
+    // worker w takes CPU slot w * cpus / n of the node-ordered CPU list
+    size_t total {0};
+    for (const NumaNode &node : nodes_) { total += node.cpus.size(); }
+    for (int w = 0; w < n; ++w) {
+      size_t slot = total * static_cast<size_t>(w) / static_cast<size_t>(n);
+      size_t node = 0;
+      while (node + 1 < nodes_.size() && slot >= nodes_[node].cpus.size()) { slot -= nodes_[node++].cpus.size(); }
+      node_of_.push_back(static_cast<int>(node));
+    }
+
+    cuts_.push_back(0);
+    for (int w = 1; w < n; ++w) { cuts_.push_back(static_cast<int>(static_cast<long long>(height) * w / n)); }
+    cuts_.push_back(height);
+
+    for (int w = 0; w < n; ++w) { threads_.emplace_back([this, w] { worker_(w); }); }
+  }
+
+  ~BandPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &t : threads_) { t.join(); }
+  }
+
+  BandPool(const BandPool &) = delete;
+  BandPool &operator=(const BandPool &) = delete;
+
+  int workers() const { return static_cast<int>(threads_.size()); }
+  int node_count() const { return static_cast<int>(nodes_.size()); }
+
+  // Calls job(worker, y0, y1) on every worker for its band and waits for all.
+  void run(const std::function<void(int, int, int)> &job) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    job_ = &job;
+    pending_ = workers();
+    ++round_;
+    wake_.notify_all();
+    done_.wait(lock, [this] { return pending_ == 0; });
+    job_ = nullptr;
+  }
+
+  // First touch: each worker zeroes its band of both buffers. The board must
+  // not be shared with a copy or snapshot yet.
+  void place(LifeBoard &board) {
+    run([&board](int, int y0, int y1) { board.clear_rows(y0, y1); });
+  }
+
+  void step(LifeBoard &board, const Rule &rule) {
+    run([&board, &rule](int, int y0, int y1) { board.step_rows(rule, y0, y1); });
+    board.swap_generation();
+  }
+
+private:
+  std::vector<NumaNode> nodes_;
+  std::vector<int> node_of_;  // per worker
+  std::vector<int> cuts_;     // band w is rows [cuts_[w], cuts_[w + 1])
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int, int, int)> *job_ {nullptr};
+  uint64_t round_ {0};
+  int pending_ {0};
+  bool stop_ {false};
+
+  void pin_(int w) {
+#ifdef __linux__
+    const NumaNode &node = nodes_[static_cast<size_t>(node_of_[static_cast<size_t>(w)])];
+    if (node.cpus.empty()) { return; }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : node.cpus) { CPU_SET(cpu, &set); }
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)w;
+#endif
+  }
+
+  void worker_(int w) {
+    pin_(w);
+    uint64_t seen {0};
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [&] { return stop_ || round_ != seen; });
+      if (stop_) { return; }
+      seen = round_;
+      const std::function<void(int, int, int)> &job = *job_;
+      lock.unlock();
+      job(w, cuts_[static_cast<size_t>(w)], cuts_[static_cast<size_t>(w) + 1]);
+      lock.lock();
+      if (--pending_ == 0) { done_.notify_one(); }
+    }
+  }
+};
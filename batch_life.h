@@ -0,0 +1,197 @@
+#pragma once
+// Many small boards stepped together, bit-sliced.
+//
+// Every uint64_t holds one cell of 64 boards ("lanes"), bit k for board k,
+// so one word operation advances that cell on all 64 boards. A batch is
+// `words` such words per cell: 512 boards with the default 8, which the
+// AVX-512 kernel tier steps with one vector per cell (AVX2 with two, the
+// generic tier a word at a time). All lanes share a board size, with the
+// usual dead boundary; each lane has its own rule.
+//
+// Lanes retire themselves: once a board comes back to the generation before
+// (a still life, or empty) or the one before that (period 2), its lane is
+// marked settled and the caller can read the result and load new work into
+// it, so a batch stays full while boards finish at different times. For
+// longer cycles a lane can mark() its current board; every later step()
+// then tells whether the board is back to the marked one.
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "cpu_kernels.h"
+#include "life_board.h"
+
+class BatchLife {
+public:
+  BatchLife(int w, int h, int words = 8)
+    : w_{w}, h_{h}, words_{words},
+      prev_(static_cast<size_t>(w + 2) * (h + 2) * words), cur_(prev_.size()), next_(prev_.size()),
+      birth_(9 * static_cast<size_t>(words)), survive_(birth_.size()),
+      changed_(static_cast<size_t>(words)), changed2_(changed_.size()), unmarked_(changed_.size()),
+      lanes_(static_cast<size_t>(words) * 64) {
+    set_rule(Rule {});
+  }
+
+  int get_w() const { return w_; }
+  int get_h() const { return h_; }
+  int lanes() const { return words_ * 64; }
+
+  void set_rule(int lane, const Rule &rule) {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    const uint64_t bit = 1ull << (lane & 63);
+    for (int n = 0; n <= 8; ++n) {
+      uint64_t &b = birth_[static_cast<size_t>(n) * words_ + k];
+      uint64_t &s = survive_[static_cast<size_t>(n) * words_ + k];
+      b = (rule.birth >> n) & 1u ? b | bit : b & ~bit;
+      s = (rule.survive >> n) & 1u ? s | bit : s & ~bit;
+    }
+  }
+  void set_rule(const Rule &rule) {
+    for (int lane = 0; lane < lanes(); ++lane) { set_rule(lane, rule); }
+  }
+  Rule rule(int lane) const {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    Rule r {0, 0};
+    for (int n = 0; n <= 8; ++n) {
+      r.birth   |= static_cast<uint16_t>(((birth_[static_cast<size_t>(n) * words_ + k] >> (lane & 63)) & 1u) << n);
+      r.survive |= static_cast<uint16_t>(((survive_[static_cast<size_t>(n) * words_ + k] >> (lane & 63)) & 1u) << n);
+    }
+    return r;
+  }
+
+  // Puts the top-left w x h cells of board into lane (dead past its edges)
+  // and starts the lane's clock.
+  void load(int lane, const LifeBoard &board) {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    const uint64_t bit = 1ull << (lane & 63);
+    for (int y = 0; y < h_; ++y) {
+      for (int x = 0; x < w_; ++x) {
+        uint64_t &c = cur_[at_(x, y) + k];
+        c = x < board.get_w() && y < board.get_h() && board.get(x, y) ? c | bit : c & ~bit;
+      }
+    }
+    Lane &l = lanes_[static_cast<size_t>(lane)];
+    if (!l.busy) { ++busy_; }
+    if (l.marked) { --marked_; }
+    l = Lane {};
+    l.busy = true;
+  }
+
+  // Empties lane and leaves it idle.
+  void clear(int lane) {
+    load(lane, LifeBoard {});
+    lanes_[static_cast<size_t>(lane)].busy = false;
+    --busy_;
+  }
+
+  LifeBoard board(int lane) const {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    LifeBoard out(w_, h_);
+    for (int y = 0; y < h_; ++y) {
+      for (int x = 0; x < w_; ++x) {
+        if ((cur_[at_(x, y) + k] >> (lane & 63)) & 1u) { out.set(x, y, true); }
+      }
+    }
+    return out;
+  }
+
+  uint64_t population(int lane) const {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    uint64_t n {0};
+    for (int y = 0; y < h_; ++y) {
+      for (int x = 0; x < w_; ++x) { n += (cur_[at_(x, y) + k] >> (lane & 63)) & 1u; }
+    }
+    return n;
+  }
+
+  // Remembers lane's current board; see at_mark(). Marking again replaces it.
+  void mark(int lane) {
+    const size_t k = static_cast<size_t>(lane >> 6);
+    const uint64_t bit = 1ull << (lane & 63);
+    if (mark_.empty()) { mark_.resize(cur_.size()); }
+    for (size_t i = k; i < cur_.size(); i += static_cast<size_t>(words_)) {
+      mark_[i] = (mark_[i] & ~bit) | (cur_[i] & bit);
+    }
+    unmarked_[k] |= bit;  // not back yet, it hasn't moved
+    Lane &l = lanes_[static_cast<size_t>(lane)];
+    if (!l.marked) { ++marked_; }
+    l.marked = true;
+    l.mark = l.age;
+  }
+
+  // Advances every lane one generation; busy lanes that came back to an
+  // earlier generation settle.
+  void step() {
+    const auto kernel = cpu_kernels().step_sliced;
+    std::fill(changed_.begin(), changed_.end(), 0);
+    std::fill(changed2_.begin(), changed2_.end(), 0);
+    for (int y = 0; y < h_; ++y) {
+      kernel(&cur_[at_(0, y - 1)], &cur_[at_(0, y)], &cur_[at_(0, y + 1)], &prev_[at_(0, y)], &next_[at_(0, y)],
+             w_, words_, birth_.data(), survive_.data(), changed_.data(), changed2_.data());
+    }
+    std::swap(prev_, cur_);
+    std::swap(cur_, next_);
+    if (marked_ > 0) {
+      std::fill(unmarked_.begin(), unmarked_.end(), 0);
+      for (size_t i = 0; i < cur_.size(); i += static_cast<size_t>(words_)) {
+        for (int k = 0; k < words_; ++k) { unmarked_[static_cast<size_t>(k)] |= cur_[i + k] ^ mark_[i + k]; }
+      }
+    }
+
+    for (int lane = 0; lane < lanes(); ++lane) {
+      Lane &l = lanes_[static_cast<size_t>(lane)];
+      if (!l.busy) { continue; }
+      ++l.age;
+      if (l.settled) { continue; }
+      const uint64_t bit = 1ull << (lane & 63);
+      if (!(changed_[static_cast<size_t>(lane >> 6)] & bit)) {
+        settle_(l, l.age - 1, 1);
+      } else if (l.age >= 2 && !(changed2_[static_cast<size_t>(lane >> 6)] & bit)) {
+        settle_(l, l.age - 2, 2);
+      }
+    }
+  }
+
+  bool busy(int lane) const { return lanes_[static_cast<size_t>(lane)].busy; }  // loaded, settled or not
+  bool settled(int lane) const { return lanes_[static_cast<size_t>(lane)].settled; }
+  uint64_t age(int lane) const { return lanes_[static_cast<size_t>(lane)].age; }  // generations since load()
+  // First generation of the final cycle, and its period (1 or 2).
+  uint64_t settle_generation(int lane) const { return lanes_[static_cast<size_t>(lane)].settle; }
+  int period(int lane) const { return lanes_[static_cast<size_t>(lane)].period; }
+  int busy_count() const { return busy_; }
+  bool marked(int lane) const { return lanes_[static_cast<size_t>(lane)].marked; }
+  uint64_t mark_age(int lane) const { return lanes_[static_cast<size_t>(lane)].mark; }  // age() when marked
+  // The board is the marked one again, as of the last step().
+  bool at_mark(int lane) const {
+    return marked(lane) && !(unmarked_[static_cast<size_t>(lane >> 6)] >> (lane & 63) & 1u);
+  }
+
+private:
+  struct Lane {
+    bool busy {false};
+    bool settled {false};
+    bool marked {false};
+    uint64_t age {0};
+    uint64_t mark {0};
+    uint64_t settle {0};
+    int period {0};
+  };
+
+  int w_, h_, words_;
+  // (w + 2) x (h + 2) cells of `words` words; the outer ring stays dead
+  std::vector<uint64_t> prev_, cur_, next_;
+  std::vector<uint64_t> birth_, survive_;      // lane masks, words per neighbor count
+  std::vector<uint64_t> changed_, changed2_;   // lanes that moved in the last step
+  std::vector<uint64_t> mark_;                 // marked boards, same layout; allocated by the first mark()
+  std::vector<uint64_t> unmarked_;             // lanes not on their marked board
+  std::vector<Lane> lanes_;
+  int busy_ {0};
+  int marked_ {0};
+
+  size_t at_(int x, int y) const { return (static_cast<size_t>(y + 1) * (w_ + 2) + (x + 1)) * words_; }
+
+  static void settle_(Lane &l, uint64_t generation, int period) {
+    l.settled = true;
+    l.settle = generation;
+    l.period = period;
+  }
+};
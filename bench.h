@@ -0,0 +1,267 @@
+#pragma once
+// Benchmark workload, run with --bench. It covers the hot paths a headless
+// run spends its time in, so it doubles as the training run for
+// profile-guided builds (see AUTO_CELL_PGO in CMakeLists.txt). Board sections
+// use the --size soup and --gens; the series ring, the bit-sliced batch and
+// the sweep's soups keep their own small fixed boards.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "batch_life.h"
+#include "change_list.h"
+#include "checkpoint.h"
+#include "frame_export.h"
+#include "life_board.h"
+#include "pattern_io.h"
+#include "region.h"
+#include "rule_sweep.h"
+#include "series_ring.h"
+#include "temporal.h"
+
+struct BenchOptions {
+  int      width       {1024};
+  int      height      {1024};
+  int      generations {100};
+  uint64_t seed        {1};
+  int      density     {35};
+};
+
+namespace bench_detail {
+
+inline double seconds_since(Uint64 start) {
+  return static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+}
+
+// Size of the largest CPU cache the OS reports, or 0 if it can't tell.
+inline size_t last_level_cache_bytes() {
+#if defined(__linux__)
+  size_t best {0};
+  for (int index = 0; index < 8; ++index) {
+    char path[64];
+    SDL_snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+    FILE *f = std::fopen(path, "r");
+    if (!f) { break; }
+    unsigned long n {0};
+    char unit {0};
+    const int got = std::fscanf(f, "%lu%c", &n, &unit);
+    std::fclose(f);
+    if (got < 1) { continue; }
+    const size_t bytes = unit == 'K' ? n << 10 : unit == 'M' ? n << 20 : n;
+    best = std::max(best, bytes);
+  }
+  return best;
+#else
+  return 0;
+#endif
+}
+
+}  // namespace bench_detail
+
+inline int run_bench(const BenchOptions &opt) {
+  using bench_detail::seconds_since;
+  if (opt.width < 1 || opt.height < 1 || opt.generations < 1) {
+    SDL_Log("bench: bad size or generation count");
+    return 1;
+  }
+  const double cells = static_cast<double>(opt.width) * opt.height;
+  uint64_t sink {0};  // keeps results observable
+
+  static const char *const kRules[] {"B3/S23", "B36/S23", "B3678/S34678"};
+  for (const char *rule_text : kRules) {
+    Rule rule;
+    parse_rule(rule_text, rule);
+    LifeBoard board(opt.width, opt.height);
+    board.fill_random(opt.seed, opt.density);
+    const Uint64 start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < opt.generations; ++g) { board.step(rule); }
+    const double s = seconds_since(start);
+    sink += board.hash();
+    SDL_Log("bench: step %-13s %dx%d  %8.1f gen/s  %7.2f Gcell/s", rule_text, opt.width, opt.height,
+            opt.generations / s, cells * opt.generations / s / 1e9);
+  }
+
+  // the parallel_for backend: stepping, census and pixel expansion
+  {
+    LifeBoard board(opt.width, opt.height);
+    board.fill_random(opt.seed, opt.density);
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < opt.generations; ++g) { board.step_parallel(Rule {}); }
+    double s = seconds_since(start);
+    SDL_Log("bench: %s backend, %d workers", parallel_backend(), worker_count());
+    SDL_Log("bench: parallel step       %dx%d  %8.1f gen/s  %7.2f Gcell/s", opt.width, opt.height,
+            opt.generations / s, cells * opt.generations / s / 1e9);
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < 100; ++i) { sink += board.population() + board.hash(); }
+    s = seconds_since(start);
+    SDL_Log("bench: census              %8.3f ms", s * 1e3 / 100);
+    const BoardView view {board.row(0), board.get_w(), board.get_h(), board.get_stride(), 0};
+    FrameStyle style;
+    style.scale = 2;
+    std::vector<uint8_t> rgb;
+    start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < 10; ++i) { render_rgb(view, FrameRegion {}, style, rgb); }
+    s = seconds_since(start);
+    sink += rgb.size();
+    SDL_Log("bench: rgb expand scale 2  %8.2f ms", s * 1e3 / 10);
+  }
+
+  // temporal blocking against plain stepping on the same --size soup. It only
+  // pays off once the board no longer fits in the last-level cache, since
+  // what it saves is passes over memory, not cell updates
+  {
+    LifeBoard start_board(opt.width, opt.height);
+    start_board.fill_random(opt.seed, opt.density);
+    const double bytes = static_cast<double>(start_board.get_stride()) * opt.height * sizeof(uint64_t);
+    const size_t llc = bench_detail::last_level_cache_bytes();
+    if (llc == 0) {
+      SDL_Log("bench: temporal board      %.1f MiB per buffer, last-level cache size unknown", bytes / 1048576);
+    } else {
+      SDL_Log("bench: temporal board      %.1f MiB per buffer, %.1f MiB last-level cache%s", bytes / 1048576,
+              static_cast<double>(llc) / 1048576, 2 * bytes > static_cast<double>(llc) ? "" :
+              " (both buffers fit; use a larger --size to see the memory-bound case)");
+    }
+    const int gens = (opt.generations + 15) / 16 * 16;  // a whole number of passes at every depth
+    LifeBoard plain = start_board;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) { plain.step(Rule {}); }
+    const double plain_s = seconds_since(start);
+    const uint64_t want = plain.hash();
+    sink += want;
+    SDL_Log("bench: temporal plain step %dx%d  %8.3f ms/gen", opt.width, opt.height, plain_s * 1e3 / gens);
+    TemporalScratch scratch;
+    for (int depth : {2, 4, 8, 16}) {
+      LifeBoard board = start_board;
+      start = SDL_GetPerformanceCounter();
+      for (int g = 0; g < gens; g += depth) {
+        step_ahead(board, Rule {}, depth, 0, opt.height, scratch);
+        board.swap_generation();
+      }
+      const double s = seconds_since(start);
+      SDL_Log("bench: temporal depth %-2d   %dx%d  %8.3f ms/gen  %5.2fx plain%s", depth, opt.width, opt.height,
+              s * 1e3 / gens, plain_s / s, board.hash() == want ? "" : "  MISMATCH");
+    }
+  }
+
+  LifeBoard board(opt.width, opt.height);
+  board.fill_random(opt.seed, opt.density);
+  const BoardView view {board.row(0), board.get_w(), board.get_h(), board.get_stride(), 0};
+  {
+    FrameStyle style;
+    style.scale = 2;
+    const Uint64 start = SDL_GetPerformanceCounter();
+    std::vector<char> png = encode_png(view, FrameRegion {}, style);
+    const double s = seconds_since(start);
+    sink += png.size();
+    SDL_Log("bench: png scale 2         %8.2f ms  %zu bytes", s * 1e3, png.size());
+  }
+  {
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const std::string rle = write_rle(board, Rule {});
+    LifeBoard back;
+    parse_rle(rle.data(), rle.size(), back);
+    const double s = seconds_since(start);
+    sink += back.population();
+    SDL_Log("bench: rle write+parse     %8.2f ms  %zu bytes", s * 1e3, rle.size());
+  }
+  {
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const std::vector<char> data = serialize_checkpoint(board.snapshot(), Rule {}, 0);
+    LifeBoard back;
+    Rule rule;
+    uint64_t gen {0};
+    parse_checkpoint(data.data(), data.size(), back, rule, gen);
+    const double s = seconds_since(start);
+    sink += back.hash();
+    SDL_Log("bench: checkpoint round    %8.2f ms  %zu bytes", s * 1e3, data.size());
+  }
+  // recording a sample per generation against a board small enough to step
+  // millions of times a second, where the ring's cost shows most
+  {
+    static SeriesRing<4096> ring;
+    LifeBoard small(64, 64);
+    small.fill_random(opt.seed, opt.density);
+    const int gens = 200000;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) { small.step(Rule {}); }
+    const double step_s = seconds_since(start);
+    start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) {
+      ring.push({static_cast<uint64_t>(g), sink, static_cast<uint64_t>(g) >> 3, static_cast<uint64_t>(g) >> 4});
+    }
+    const double push_s = seconds_since(start);
+    sink += small.hash() + ring.pushed();
+    SDL_Log("bench: series push         %8.2f ns  %5.2f%% of a 64x64 step (%.0f gen/s)", push_s * 1e9 / gens,
+            100.0 * push_s / step_s, gens / step_s);
+  }
+  // a glider gun on an otherwise empty --size board: the packed step pays for
+  // every cell, the change list only for the cells around the gun and its
+  // gliders
+  {
+    static const char kGun[] = "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bo"
+                               "bo$10bo5bo7bo$11bo3bo$12b2o!";
+    LifeBoard gun;
+    parse_rle(kGun, sizeof(kGun) - 1, gun);
+    const int w = std::max(opt.width, gun.get_w() + 32), h = std::max(opt.height, gun.get_h() + 32);
+    LifeBoard packed(w, h);
+    copy_cells(gun, 0, 0, gun.get_w(), gun.get_h(), packed, 16, 16);
+    LifeBoard sparse = packed;
+    const int gens = opt.generations;
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) { packed.step(Rule {}); }
+    const double packed_s = seconds_since(start);
+    ChangeListStepper stepper;
+    stepper.reset(sparse);
+    start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) { stepper.step(sparse, Rule {}); }
+    const double sparse_s = seconds_since(start);
+    sink += packed.hash() + sparse.hash();
+    SDL_Log("bench: gun packed          %dx%d  %8.1f gen/s", w, h, gens / packed_s);
+    SDL_Log("bench: gun change list     %dx%d  %8.1f gen/s  %zu cells looked at in the last generation", w, h,
+            gens / sparse_s, stepper.evaluated());
+  }
+  // 512 small boards: one at a time on the packed kernels, then bit-sliced in
+  // one batch
+  {
+    const int gens = 1000;
+    BatchLife batch(16, 16);
+    std::vector<LifeBoard> boards;
+    for (int lane = 0; lane < batch.lanes(); ++lane) {
+      LifeBoard soup(16, 16);
+      soup.fill_random(opt.seed + static_cast<uint64_t>(lane), opt.density);
+      batch.load(lane, soup);
+      boards.push_back(soup);
+    }
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (LifeBoard &b : boards) {
+      for (int g = 0; g < gens; ++g) { b.step(Rule {}); }
+      sink += b.hash();
+    }
+    const double one_s = seconds_since(start);
+    start = SDL_GetPerformanceCounter();
+    for (int g = 0; g < gens; ++g) { batch.step(); }
+    const double batch_s = seconds_since(start);
+    sink += batch.population(0);
+    const double cells = 256.0 * batch.lanes() * gens;
+    SDL_Log("bench: 16x16 one by one    %d boards  %7.2f Gcell/s", batch.lanes(), cells / one_s / 1e9);
+    SDL_Log("bench: 16x16 bit-sliced    %d boards  %7.2f Gcell/s", batch.lanes(), cells / batch_s / 1e9);
+  }
+  // the rule sweep's default soups over the 2^13 rules containing B36/S238,
+  // each run for --gens generations
+  {
+    SweepOptions sweep;
+    parse_rule("B36/S238", sweep.require);
+    sweep.seed = opt.seed;
+    sweep.density = opt.density;
+    sweep.generations = opt.generations;
+    const Uint64 start = SDL_GetPerformanceCounter();
+    const SweepResults res = sweep_rule_space(sweep);
+    const double s = seconds_since(start);
+    sink += res.behavior[0];
+    SDL_Log("bench: rule sweep          %zu rules  %8.1f rules/s", res.rows(), res.rows() / s);
+  }
+  SDL_Log("bench: done (%016llx)", static_cast<unsigned long long>(sink));
+  return 0;
+}
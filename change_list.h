@@ -0,0 +1,149 @@
+#pragma once
+// Change-list stepping for boards that are almost entirely empty.
+//
+// A cell's next state depends only on its 3x3 neighbourhood, so a cell whose
+// neighbourhood didn't change last generation keeps its state this one. The
+// stepper remembers which cells flipped, evaluates only those cells and their
+// neighbours, and flips the ones whose state changes. A generation costs
+// about nine cell evaluations per flip and nothing per empty cell, which
+// suits a gun or a glider stream on a plane of millions of dead cells. A busy
+// soup is far slower this way than the packed kernels.
+//
+// Rules with B0 are out: there, an empty neighbourhood is born, so empty
+// space changes without any neighbouring flip.
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "cpu_kernels.h"
+#include "life_board.h"
+
+// Open-addressed set of 64-bit keys. clear() moves to a new epoch instead of
+// wiping the table, so emptying it costs the same however full it was.
+class EpochSet {
+public:
+  // Returns true if key wasn't in the set yet.
+  bool insert(uint64_t key) {
+    if ((size_ + 1) * 2 > keys_.size()) { grow_(); }
+    const size_t mask = keys_.size() - 1;
+    for (size_t i = mix64(key) & mask;; i = (i + 1) & mask) {
+      if (stamps_[i] != epoch_) {
+        stamps_[i] = epoch_;
+        keys_[i] = key;
+        ++size_;
+        return true;
+      }
+      if (keys_[i] == key) { return false; }
+    }
+  }
+
+  void clear() {
+    size_ = 0;
+    if (++epoch_ == 0) {  // every 2^32 clears, stale stamps could match again
+      std::fill(stamps_.begin(), stamps_.end(), 0u);
+      epoch_ = 1;
+    }
+  }
+
+  size_t size() const { return size_; }
+
+private:
+  std::vector<uint64_t> keys_;
+  std::vector<uint32_t> stamps_;  // slot is in the set when it holds epoch_
+  uint32_t epoch_ {1};
+  size_t size_ {0};
+
+  void grow_() {
+    std::vector<uint64_t> live;
+    live.reserve(size_);
+    for (size_t i = 0; i < keys_.size(); ++i) {
+      if (stamps_[i] == epoch_) { live.push_back(keys_[i]); }
+    }
+    const size_t cap = std::max<size_t>(1024, keys_.size() * 2);
+    keys_.assign(cap, 0);
+    stamps_.assign(cap, 0u);
+    epoch_ = 1;
+    size_ = 0;
+    for (uint64_t k : live) { insert(k); }
+  }
+};
+
+class ChangeListStepper {
+public:
+  static bool supports(const Rule &rule) { return !(rule.birth & 1u); }
+
+  // Starts over from board as it is now, counting every live cell as just
+  // changed. Needed after the board is changed other than by step().
+  void reset(const LifeBoard &board) {
+    w_ = board.get_w();
+    h_ = board.get_h();
+    changed_.clear();
+    for (int y = 0; y < h_; ++y) {
+      const uint64_t *r = board.row(y);
+      for (int wi = 0; wi < board.get_stride(); ++wi) {
+        for (uint64_t bits = r[wi]; bits; bits &= bits - 1) {
+          changed_.push_back(key_(wi * 64 + __builtin_ctzll(bits), y));
+        }
+      }
+    }
+    primed_ = false;
+  }
+
+  // Advances board one generation; rule must pass supports(). A new rule
+  // invalidates what the last step learned, so the stepper resets itself.
+  void step(LifeBoard &board, const Rule &rule) {
+    if (board.get_w() != w_ || board.get_h() != h_ || (primed_ && !(rule == rule_))) { reset(board); }
+    rule_ = rule;
+    primed_ = true;
+
+    // every cell next to a flip, once each
+    seen_.clear();
+    candidates_.clear();
+    for (uint64_t k : changed_) {
+      const int x = key_x_(k), y = key_y_(k);
+      for (int ny = std::max(0, y - 1); ny <= std::min(h_ - 1, y + 1); ++ny) {
+        for (int nx = std::max(0, x - 1); nx <= std::min(w_ - 1, x + 1); ++nx) {
+          const uint64_t n = key_(nx, ny);
+          if (seen_.insert(n)) { candidates_.push_back(n); }
+        }
+      }
+    }
+    evaluated_ = candidates_.size();
+
+    // decide every flip against the current generation before making any
+    const LifeBoard &cur = board;
+    changed_.clear();
+    for (uint64_t k : candidates_) {
+      const int x = key_x_(k), y = key_y_(k);
+      int n {0};  // the cell itself included
+      for (int ny = std::max(0, y - 1); ny <= std::min(h_ - 1, y + 1); ++ny) {
+        const uint64_t *r = cur.row(ny);
+        for (int nx = std::max(0, x - 1); nx <= std::min(w_ - 1, x + 1); ++nx) {
+          n += static_cast<int>((r[nx >> 6] >> (nx & 63)) & 1u);
+        }
+      }
+      const bool alive = cur.get(x, y);
+      if (rule.next(alive, n - alive) != alive) { changed_.push_back(k); }
+    }
+    for (uint64_t k : changed_) {
+      const int x = key_x_(k);
+      board.row(key_y_(k))[x >> 6] ^= 1ull << (x & 63);
+    }
+  }
+
+  size_t changes() const { return changed_.size(); }  // cells the last step flipped
+  size_t evaluated() const { return evaluated_; }     // cells the last step looked at
+
+private:
+  int w_ {-1};
+  int h_ {-1};
+  Rule rule_ {};
+  bool primed_ {false};
+  std::vector<uint64_t> changed_;     // flipped by the last step; live cells after reset()
+  std::vector<uint64_t> candidates_;  // scratch, in first-seen order
+  EpochSet seen_;
+  size_t evaluated_ {0};
+
+  static uint64_t key_(int x, int y) { return (static_cast<uint64_t>(y) << 32) | static_cast<uint32_t>(x); }
+  static int key_x_(uint64_t k) { return static_cast<int>(static_cast<uint32_t>(k)); }
+  static int key_y_(uint64_t k) { return static_cast<int>(k >> 32); }
+};
@@ -0,0 +1,207 @@
+#pragma once
+// Crash-safe checkpoints for long headless runs.
+//
+// Taking a checkpoint only grabs a LifeBoard::snapshot(), which shares the
+// current generation instead of copying it; the step loop carries on at
+// once while the I/O thread serializes the snapshot, writes it to a temp
+// file, fsyncs and renames it to DIR/checkpoint-<generation>.acc. The newest
+// few files are kept, and restore picks the newest one whose checksum holds.
+//
+// File layout (native endianness):
+//   CheckpointHeader, then stride * height uint64_t words of packed rows.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "async_io.h"
+#include "life_board.h"
+
+struct CheckpointHeader {
+  uint32_t magic;
+  uint32_t version;
+  int32_t  width;
+  int32_t  height;
+  int32_t  stride;
+  uint16_t birth;
+  uint16_t survive;
+  uint64_t generation;
+  uint64_t checksum;  // over the packed rows
+};
+
+constexpr uint32_t kCheckpointMagic   {0x4b434341};  // "ACCK"
+constexpr uint32_t kCheckpointVersion {2};
+constexpr size_t   kCheckpointMaxBytes {size_t {1} << 30};  // larger files are not read
+
+// Covers the header fields as well as the rows, so a damaged generation or
+// rule is caught too.
+inline uint64_t checkpoint_checksum(const CheckpointHeader &hdr, const uint64_t *words, size_t count) {
+  uint64_t h {0x6a09e667f3bcc908ull};
+  h = mix64(h ^ (static_cast<uint64_t>(static_cast<uint32_t>(hdr.width)) << 32 | static_cast<uint32_t>(hdr.height)));
+  h = mix64(h ^ (static_cast<uint64_t>(hdr.birth) << 32 | hdr.survive));
+  h = mix64(h ^ hdr.generation);
+  for (size_t i = 0; i < count; ++i) { h = mix64(h ^ words[i]) + i; }
+  return h;
+}
+
+inline std::vector<char> serialize_checkpoint(const BoardSnapshot &snap, const Rule &rule, uint64_t generation) {
+  const size_t words = static_cast<size_t>(snap.stride) * snap.height;
+  CheckpointHeader h {kCheckpointMagic, kCheckpointVersion, snap.width, snap.height, snap.stride,
+                      rule.birth, rule.survive, generation, 0};
+  h.checksum = checkpoint_checksum(h, snap.bits->data(), words);
+  const char *header = reinterpret_cast<const char *>(&h);
+  const char *rows = reinterpret_cast<const char *>(snap.bits->data());
+  std::vector<char> out;
+  out.reserve(sizeof(h) + words * sizeof(uint64_t));
+  out.insert(out.end(), header, header + sizeof(h));
+  out.insert(out.end(), rows, rows + words * sizeof(uint64_t));
+  return out;
+}
+
+inline bool parse_checkpoint(const char *data, size_t size, LifeBoard &board, Rule &rule,
+                             uint64_t &generation, std::string *error = nullptr) {
+  auto fail = [&](const char *msg) { if (error) { *error = msg; } return false; };
+  CheckpointHeader h;
+  if (size < sizeof(h)) { return fail("truncated header"); }
+  std::memcpy(&h, data, sizeof(h));
+  if (h.magic != kCheckpointMagic || h.version != kCheckpointVersion) { return fail("not a checkpoint"); }
+  if (h.width <= 0 || h.height <= 0 || h.stride != (static_cast<int64_t>(h.width) + 63) / 64) { return fail("bad dimensions"); }
+  const size_t words = static_cast<size_t>(h.stride) * static_cast<size_t>(h.height);
+  if ((size - sizeof(h)) / sizeof(uint64_t) != words || (size - sizeof(h)) % sizeof(uint64_t)) {
+    return fail("payload size mismatch");
+  }
+
+  LifeBoard b(h.width, h.height);
+  std::memcpy(b.row(0), data + sizeof(h), words * sizeof(uint64_t));
+  if (checkpoint_checksum(h, b.row(0), words) != h.checksum) { return fail("checksum mismatch"); }
+  for (int y = 0; y < h.height; ++y) {
+    if (b.row(y)[h.stride - 1] & ~b.tail_mask()) { return fail("cells past the width"); }
+  }
+  board = std::move(b);
+  rule = Rule {h.birth, h.survive};
+  generation = h.generation;
+  return true;
+}
+
+class Checkpointer {
+public:
+  // Saves every `every_gens` generations and/or every `every_secs` seconds (0 = off).
+  Checkpointer(AsyncIo &io, std::string dir, uint64_t every_gens, double every_secs, int keep = 3)
+    : io_{io}, dir_{std::move(dir)}, every_gens_{every_gens}, keep_{keep},
+      every_ticks_{static_cast<Uint64>(every_secs * static_cast<double>(SDL_GetPerformanceFrequency()))},
+      last_ticks_{SDL_GetPerformanceCounter()} {
+    std::error_code ec;
+    std::filesystem::create_directories(dir_, ec);
+  }
+
+  bool enabled() const { return every_gens_ > 0 || every_ticks_ > 0; }
+
+  // Sets the generation the run starts from, so a resumed run saves
+  // `every_gens` after the checkpoint it restored rather than straight away.
+  void start(uint64_t generation) {
+    last_gen_ = generation;
+    last_ticks_ = SDL_GetPerformanceCounter();
+  }
+
+  // Called once per generation; cheap unless a checkpoint is due.
+  void maybe_save(const LifeBoard &board, const Rule &rule, uint64_t generation) {
+    bool due = every_gens_ > 0 && generation >= last_gen_ + every_gens_;
+    if (!due && every_ticks_ > 0) { due = SDL_GetPerformanceCounter() - last_ticks_ >= every_ticks_; }
+    if (!due) { return; }
+    io_.poll_completions();
+    if (writing_) { return; }  // previous checkpoint still on its way to disk
+    save(board, rule, generation);
+  }
+
+  void save(const LifeBoard &board, const Rule &rule, uint64_t generation) {
+    last_gen_ = generation;
+    last_ticks_ = SDL_GetPerformanceCounter();
+    writing_ = true;
+    BoardSnapshot snap = board.snapshot();
+    io_.write_file_with(path_for_(generation),
+      [snap, rule, generation] { return serialize_checkpoint(snap, rule, generation); },
+      [this](IoResult &r) {
+        writing_ = false;
+        if (r.ok) { prune_(); }
+      },
+      true);
+  }
+
+  // Waits for the checkpoint in flight, if any, to reach disk.
+  void flush() {
+    for (io_.poll_completions(); writing_; io_.poll_completions()) { SDL_Delay(1); }
+  }
+
+  // Loads the newest checkpoint in dir that parses and checksums cleanly.
+  static bool restore_latest(const std::string &dir, LifeBoard &board, Rule &rule, uint64_t &generation) {
+    std::vector<std::pair<uint64_t, std::string>> files = list_(dir);
+    for (auto it = files.rbegin(); it != files.rend(); ++it) {
+      std::vector<char> data;
+      if (!read_all_(it->second, data)) { continue; }
+      std::string error;
+      if (parse_checkpoint(data.data(), data.size(), board, rule, generation, &error)) {
+        SDL_Log("checkpoint: restored %s", it->second.c_str());
+        return true;
+      }
+      SDL_Log("checkpoint: skipping %s: %s", it->second.c_str(), error.c_str());
+    }
+    SDL_Log("checkpoint: nothing to restore in %s", dir.c_str());
+    return false;
+  }
+
+private:
+  AsyncIo &io_;
+  std::string dir_;
+  uint64_t every_gens_;
+  int keep_;
+  Uint64 every_ticks_;
+  Uint64 last_ticks_;
+  uint64_t last_gen_ {0};
+  bool writing_ {false};
+
+  std::string path_for_(uint64_t generation) const {
+    char name[48];
+    SDL_snprintf(name, sizeof(name), "checkpoint-%012llu.acc", static_cast<unsigned long long>(generation));
+    return (std::filesystem::path(dir_) / name).string();
+  }
+
+  // checkpoint files in dir, oldest first
+  static std::vector<std::pair<uint64_t, std::string>> list_(const std::string &dir) {
+    std::vector<std::pair<uint64_t, std::string>> files;
+    std::error_code ec;
+    for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+      unsigned long long gen {0};
+      std::string name = entry.path().filename().string();
+      char tail[8] {};
+      if (SDL_sscanf(name.c_str(), "checkpoint-%llu.%4s", &gen, tail) == 2 && SDL_strcmp(tail, "acc") == 0) {
+        files.emplace_back(static_cast<uint64_t>(gen), entry.path().string());
+      }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  static bool read_all_(const std::string &path, std::vector<char> &out) {
+    FILE *f = std::fopen(path.c_str(), "rb");
+    if (!f) { return false; }
+    char buf[1 << 16];
+    size_t n;
+    while ((n = std::fread(buf, 1, sizeof(buf), f)) > 0 && out.size() + n <= kCheckpointMaxBytes) {
+      out.insert(out.end(), buf, buf + n);
+    }
+    bool ok = !std::ferror(f) && n == 0;
+    std::fclose(f);
+    return ok;
+  }
+
+  void prune_() {
+    std::vector<std::pair<uint64_t, std::string>> files = list_(dir_);
+    std::error_code ec;
+    for (size_t i = 0; i + static_cast<size_t>(keep_) < files.size(); ++i) {
+      std::filesystem::remove(files[i].second, ec);
+    }
+  }
+};
@@ -0,0 +1,468 @@
+#pragma once
+// Local control endpoint for driving the app from scripts and test harnesses.
+//
+// Listens on "unix:/path/to.sock" or "tcp:PORT" (bound to 127.0.0.1). The
+// protocol is line based; several commands may share a line separated by ';'
+// and each command gets exactly one reply line, "ok [...]" or "err <reason>":
+//
+//   size                 -> ok W H
+//   clear                -> ok
+//   load X Y RLE         -> ok          stamp an RLE body (e.g. bo$2bo$3o!) at X,Y
+//   step N               -> ok GEN      advance N generations
+//   run | pause          -> ok
+//   pop                  -> ok POPULATION
+//   gen                  -> ok GENERATION
+//   dump X Y W H         -> ok RLE      region as a one-line RLE body
+//   analyze X Y W H      -> ok KIND PERIOD DX DY MINPOP MAXPOP SETTLE
+//                                       period and motion of the region's
+//                                       cells alone, see analyzer.h
+//   roi X Y W H [EDGE]   -> ok          copy a region out to run on its own;
+//                                       EDGE is dead (default) or torus
+//   roi-step N           -> ok GEN      advance the region, board untouched
+//   roi-dump             -> ok RLE      the region as a one-line RLE body
+//   roi-commit           -> ok          write the region back and drop it;
+//                                       err if the board was resized since
+//   roi-discard          -> ok          drop the region
+//
+// Each client has at most one region, and it lives until committed,
+// discarded or the client disconnects.
+//
+// poll() is called once per frame, never blocks, and stops after a time
+// budget; a long "step" resumes on the next frame before its reply is sent.
+//
+// Clients are untrusted: lines are capped, a client that queues commands or
+// leaves replies unread faster than they drain is not read from until it
+// catches up, and loaded patterns may not be larger than the board.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "analyzer.h"
+#include "life_board.h"
+#include "pattern_io.h"
+#include "region.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define AUTO_CELL_HAS_CONTROL 1
+#endif
+
+// What the control server drives. Coordinates are board cells.
+class ControlTarget {
+public:
+  virtual ~ControlTarget() = default;
+  virtual int  board_w() const = 0;
+  virtual int  board_h() const = 0;
+  virtual bool cell(int x, int y) const = 0;
+  virtual void set_cell(int x, int y, bool alive) = 0;
+  virtual void clear_board() = 0;
+  virtual void step(int generations) = 0;
+  virtual void set_running(bool running) = 0;
+  virtual uint64_t population() const = 0;
+  virtual uint64_t generation() const = 0;
+};
+
+// Protocol target backed by a plain board, for driving the control server
+// without a window (the self-check and the fuzz targets).
+class BoardTarget : public ControlTarget {
+public:
+  explicit BoardTarget(LifeBoard board) : board_{std::move(board)} {}
+  int  board_w() const override { return board_.get_w(); }
+  int  board_h() const override { return board_.get_h(); }
+  bool cell(int x, int y) const override { return board_.get(x, y); }
+  void set_cell(int x, int y, bool alive) override { board_.set(x, y, alive); }
+  void clear_board() override { board_.clear(); }
+  void step(int generations) override {
+    for (int i = 0; i < generations; ++i) { board_.step(Rule {}); }
+    generation_ += static_cast<uint64_t>(generations);
+  }
+  void set_running(bool) override {}
+  uint64_t population() const override { return board_.population(); }
+  uint64_t generation() const override { return generation_; }
+
+private:
+  LifeBoard board_;
+  uint64_t generation_ {0};
+};
+
+#if defined(AUTO_CELL_HAS_CONTROL)
+
+class ControlServer {
+public:
+  ControlServer() = default;
+  ControlServer(const ControlServer&) = delete;
+  ~ControlServer() {
+    for (Client &c : clients_) { close(c.fd); }
+    if (listen_fd_ >= 0) { close(listen_fd_); }
+    if (!unix_path_.empty()) { unlink(unix_path_.c_str()); }
+  }
+
+  bool listen(const char *endpoint) {
+    if (SDL_strncmp(endpoint, "unix:", 5) == 0) {
+      sockaddr_un addr {};
+      addr.sun_family = AF_UNIX;
+      if (SDL_strlen(endpoint + 5) >= sizeof(addr.sun_path)) {
+        SDL_Log("control: socket path too long");
+        return false;
+      }
+      SDL_strlcpy(addr.sun_path, endpoint + 5, sizeof(addr.sun_path));
+      unlink(addr.sun_path);
+      listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+      if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        SDL_Log("control: cannot bind %s: %s", endpoint, strerror(errno));
+        return false;
+      }
+      unix_path_ = addr.sun_path;
+    } else if (SDL_strncmp(endpoint, "tcp:", 4) == 0) {
+      sockaddr_in addr {};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(static_cast<uint16_t>(SDL_atoi(endpoint + 4)));
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+      int one {1};
+      if (listen_fd_ >= 0) { setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)); }
+      if (listen_fd_ < 0 || bind(listen_fd_, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        SDL_Log("control: cannot bind %s: %s", endpoint, strerror(errno));
+        return false;
+      }
+    } else {
+      SDL_Log("control: endpoint must be unix:PATH or tcp:PORT, got %s", endpoint);
+      return false;
+    }
+    if (::listen(listen_fd_, 8) < 0) {
+      SDL_Log("control: listen failed: %s", strerror(errno));
+      return false;
+    }
+    set_nonblocking_(listen_fd_);
+    SDL_Log("control: listening on %s", endpoint);
+    return true;
+  }
+
+  bool is_listening() const { return listen_fd_ >= 0; }
+
+  // True while commands are queued or replies are still unsent, i.e. the
+  // caller should keep polling promptly.
+  bool busy() const {
+    for (const Client &c : clients_) { if (!c.pending.empty() || !c.out.empty()) { return true; } }
+    return false;
+  }
+
+  // Accepts, reads, executes and replies within budget_ns, without blocking.
+  // Returns true if any command ran or any client came or went, i.e. the
+  // board or the set of clients may have changed.
+  bool poll(ControlTarget &target, Uint64 budget_ns = 4000000) {
+    if (listen_fd_ < 0) { return false; }
+    bool active {false};
+    const Uint64 deadline = SDL_GetTicksNS() + budget_ns;
+
+    for (int fd; (fd = accept(listen_fd_, nullptr, nullptr)) >= 0;) {
+      set_nonblocking_(fd);
+      Client c;
+      c.fd = fd;
+      clients_.push_back(std::move(c));
+      active = true;
+    }
+
+    for (Client &c : clients_) {
+      if (c.pending.size() < kMaxPending && c.out.size() < kMaxOut) { read_(c); }
+      while (!c.pending.empty() && SDL_GetTicksNS() < deadline) {
+        active = true;
+        if (!execute_(c, target, deadline)) { break; }
+      }
+      flush_(c);
+    }
+
+    for (size_t i = clients_.size(); i-- > 0;) {
+      if (clients_[i].closed && clients_[i].out.empty()) {
+        close(clients_[i].fd);
+        clients_.erase(clients_.begin() + static_cast<std::ptrdiff_t>(i));
+        active = true;
+      }
+    }
+    return active;
+  }
+
+  // Runs data as if one client had sent it, without a socket, and returns
+  // the replies. Commands still waiting when budget_ns is up are dropped.
+  std::string run_script(ControlTarget &target, const char *data, size_t size, Uint64 budget_ns = 4000000) {
+    const Uint64 deadline = SDL_GetTicksNS() + budget_ns;
+    Client c;
+    c.in.assign(data, size);
+    c.in += '\n';
+    split_(c);
+    while (!c.pending.empty() && SDL_GetTicksNS() < deadline && execute_(c, target, deadline)) {}
+    return c.out;
+  }
+
+private:
+  static constexpr size_t kMaxLine    = 1u << 20;
+  static constexpr size_t kMaxPending = 1024;     // parsed commands waiting to run
+  static constexpr size_t kMaxOut     = 4u << 20; // reply bytes waiting to be sent
+
+  struct Client {
+    int fd {-1};
+    std::string in;
+    size_t scanned {0};               // bytes of `in` already searched for a separator
+    std::string out;
+    std::deque<std::string> pending;  // parsed commands, oldest first
+    int64_t steps_left {-1};          // progress of a "step" or "roi-step" that spans frames
+    std::unique_ptr<RegionRun> roi;   // cells copied out by "roi"
+    int roi_x {0};                    // where they came from on the board
+    int roi_y {0};
+    int roi_board_w {0};              // board size when "roi" ran
+    int roi_board_h {0};
+    bool closed {false};
+  };
+
+  int listen_fd_ {-1};
+  std::string unix_path_;
+  std::vector<Client> clients_;
+
+  static void set_nonblocking_(int fd) { fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK); }
+
+  void read_(Client &c) {
+    char buf[4096];
+    for (;;) {
+      ssize_t n = recv(c.fd, buf, sizeof(buf), 0);
+      if (n > 0) { c.in.append(buf, static_cast<size_t>(n)); continue; }
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) { c.closed = true; }
+      if (n < 0 && errno == EINTR) { continue; }
+      break;
+    }
+    split_(c);
+  }
+
+  // Moves complete commands from c.in to c.pending.
+  static void split_(Client &c) {
+    // only bytes that arrived since the last call are searched, so a long
+    // line delivered in small pieces is still scanned once
+    size_t start {0};
+    for (size_t i = c.scanned; i < c.in.size(); ++i) {
+      if (c.in[i] == '\n' || c.in[i] == ';') {
+        size_t len = i - start;
+        while (len > 0 && (c.in[start + len - 1] == '\r' || c.in[start + len - 1] == ' ')) { --len; }
+        while (len > 0 && c.in[start] == ' ') { ++start; --len; }
+        if (len > 0) { c.pending.emplace_back(c.in, start, len); }
+        start = i + 1;
+      }
+    }
+    c.in.erase(0, start);
+    c.scanned = c.in.size();
+    if (c.in.size() > kMaxLine) {
+      c.out += "err line too long\n";
+      c.in.clear();
+      c.closed = true;
+    }
+  }
+
+  void flush_(Client &c) {
+    while (!c.out.empty()) {
+      ssize_t n = send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+      if (n > 0) { c.out.erase(0, static_cast<size_t>(n)); continue; }
+      if (n < 0 && errno == EINTR) { continue; }
+      if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) { break; }
+      c.out.clear();
+      c.closed = true;
+    }
+  }
+
+  // Runs the oldest pending command. Returns false if it ran out of time
+  // and must be resumed next frame.
+  bool execute_(Client &c, ControlTarget &target, Uint64 deadline) {
+    const std::string &cmd = c.pending.front();
+    char op[16] {};
+    int consumed {0};
+    SDL_sscanf(cmd.c_str(), "%15s%n", op, &consumed);
+    const char *args = cmd.c_str() + consumed;
+    char reply[128];
+
+    if (SDL_strcmp(op, "step") == 0) {
+      if (c.steps_left < 0) {
+        long long n {-1};
+        if (SDL_sscanf(args, "%lld", &n) != 1 || n < 0) { return reply_(c, "err step needs a count"); }
+        c.steps_left = n;
+      }
+      // chunks keep the clock checks cheap relative to the stepping
+      while (c.steps_left > 0) {
+        int chunk = c.steps_left < 64 ? static_cast<int>(c.steps_left) : 64;
+        target.step(chunk);
+        c.steps_left -= chunk;
+        if (c.steps_left > 0 && SDL_GetTicksNS() >= deadline) { return false; }
+      }
+      c.steps_left = -1;
+      SDL_snprintf(reply, sizeof(reply), "ok %llu", static_cast<unsigned long long>(target.generation()));
+      return reply_(c, reply);
+    }
+    if (SDL_strcmp(op, "size") == 0) {
+      SDL_snprintf(reply, sizeof(reply), "ok %d %d", target.board_w(), target.board_h());
+      return reply_(c, reply);
+    }
+    if (SDL_strcmp(op, "clear") == 0) {
+      target.clear_board();
+      return reply_(c, "ok");
+    }
+    if (SDL_strcmp(op, "run") == 0 || SDL_strcmp(op, "pause") == 0) {
+      target.set_running(op[0] == 'r');
+      return reply_(c, "ok");
+    }
+    if (SDL_strcmp(op, "pop") == 0) {
+      SDL_snprintf(reply, sizeof(reply), "ok %llu", static_cast<unsigned long long>(target.population()));
+      return reply_(c, reply);
+    }
+    if (SDL_strcmp(op, "gen") == 0) {
+      SDL_snprintf(reply, sizeof(reply), "ok %llu", static_cast<unsigned long long>(target.generation()));
+      return reply_(c, reply);
+    }
+    if (SDL_strcmp(op, "load") == 0) {
+      int x {0}, y {0}, at {0};
+      if (SDL_sscanf(args, "%d %d %n", &x, &y, &at) < 2 || at == 0) { return reply_(c, "err load needs X Y RLE"); }
+      if (x < -target.board_w() || x > target.board_w() || y < -target.board_h() || y > target.board_h()) {
+        return reply_(c, "err load position outside the board");
+      }
+      LifeBoard pattern;
+      std::string error;
+      const char *rle = args + at;
+      PatternLimits limits;
+      limits.max_width  = target.board_w();
+      limits.max_height = target.board_h();
+      limits.max_cells  = static_cast<int64_t>(target.board_w()) * target.board_h();
+      if (!parse_rle(rle, SDL_strlen(rle), pattern, nullptr, &error, limits)) { return reply_(c, ("err " + error).c_str()); }
+      // only the part that lands on the board is visited
+      const int px0 = std::max(0, -x), py0 = std::max(0, -y);
+      const int px1 = std::min(pattern.get_w(), target.board_w() - x);
+      const int py1 = std::min(pattern.get_h(), target.board_h() - y);
+      for (int py = py0; py < py1; ++py) {
+        for (int px = px0; px < px1; ++px) {
+          if (pattern.get(px, py)) { target.set_cell(x + px, y + py, true); }
+        }
+      }
+      return reply_(c, "ok");
+    }
+    if (SDL_strcmp(op, "dump") == 0) {
+      int x {0}, y {0}, w {0}, h {0};
+      if (SDL_sscanf(args, "%d %d %d %d", &x, &y, &w, &h) != 4 || w <= 0 || h <= 0 ||
+          x < 0 || y < 0 || x >= target.board_w() || y >= target.board_h() ||
+          w > target.board_w() - x || h > target.board_h() - y) {
+        return reply_(c, "err dump needs X Y W H inside the board");
+      }
+      LifeBoard region(w, h);
+      for (int ry = 0; ry < h; ++ry) {
+        for (int rx = 0; rx < w; ++rx) {
+          if (target.cell(x + rx, y + ry)) { region.set(rx, ry, true); }
+        }
+      }
+      return reply_(c, ("ok " + rle_body(region, 0)).c_str());
+    }
+    if (SDL_strcmp(op, "analyze") == 0) {
+      int x {0}, y {0}, w {0}, h {0};
+      if (SDL_sscanf(args, "%d %d %d %d", &x, &y, &w, &h) != 4 || w <= 0 || h <= 0 ||
+          x < 0 || y < 0 || x >= target.board_w() || y >= target.board_h() ||
+          w > target.board_w() - x || h > target.board_h() - y) {
+        return reply_(c, "err analyze needs X Y W H inside the board");
+      }
+      LifeBoard region(w, h);
+      for (int ry = 0; ry < h; ++ry) {
+        for (int rx = 0; rx < w; ++rx) {
+          if (target.cell(x + rx, y + ry)) { region.set(rx, ry, true); }
+        }
+      }
+      const PatternAnalysis a = analyze_pattern(region, Rule {});
+      SDL_snprintf(reply, sizeof(reply), "ok %s %llu %d %d %llu %llu %llu", analysis_kind_name(a.kind),
+                   static_cast<unsigned long long>(a.period), a.dx, a.dy,
+                   static_cast<unsigned long long>(a.min_population), static_cast<unsigned long long>(a.max_population),
+                   static_cast<unsigned long long>(a.settle));
+      return reply_(c, reply);
+    }
+    if (SDL_strcmp(op, "roi") == 0) {
+      int x {0}, y {0}, w {0}, h {0};
+      char edge_text[8] {"dead"};
+      RegionEdge edge {RegionEdge::kDead};
+      const int got = SDL_sscanf(args, "%d %d %d %d %7s", &x, &y, &w, &h, edge_text);
+      if (got < 4 || w <= 0 || h <= 0 || x < 0 || y < 0 || x >= target.board_w() || y >= target.board_h() ||
+          w > target.board_w() - x || h > target.board_h() - y) {
+        return reply_(c, "err roi needs X Y W H inside the board");
+      }
+      if (!parse_region_edge(edge_text, edge)) { return reply_(c, "err roi edge must be dead or torus"); }
+      LifeBoard region(w, h);
+      for (int ry = 0; ry < h; ++ry) {
+        for (int rx = 0; rx < w; ++rx) {
+          if (target.cell(x + rx, y + ry)) { region.set(rx, ry, true); }
+        }
+      }
+      c.roi = std::make_unique<RegionRun>(region, 0, 0, w, h, edge);
+      c.roi_x = x;
+      c.roi_y = y;
+      c.roi_board_w = target.board_w();
+      c.roi_board_h = target.board_h();
+      return reply_(c, "ok");
+    }
+    if (SDL_strncmp(op, "roi-", 4) == 0) {
+      if (!c.roi) { return reply_(c, "err no roi"); }
+      const char *sub = op + 4;
+      if (SDL_strcmp(sub, "step") == 0) {
+        if (c.steps_left < 0) {
+          long long n {-1};
+          if (SDL_sscanf(args, "%lld", &n) != 1 || n < 0) { return reply_(c, "err roi-step needs a count"); }
+          c.steps_left = n;
+        }
+        while (c.steps_left > 0) {
+          int chunk = c.steps_left < 64 ? static_cast<int>(c.steps_left) : 64;
+          c.roi->step(Rule {}, static_cast<uint64_t>(chunk));
+          c.steps_left -= chunk;
+          if (c.steps_left > 0 && SDL_GetTicksNS() >= deadline) { return false; }
+        }
+        c.steps_left = -1;
+        SDL_snprintf(reply, sizeof(reply), "ok %llu", static_cast<unsigned long long>(c.roi->generation()));
+        return reply_(c, reply);
+      }
+      if (SDL_strcmp(sub, "dump") == 0) { return reply_(c, ("ok " + rle_body(c.roi->cells(), 0)).c_str()); }
+      if (SDL_strcmp(sub, "commit") == 0) {
+        // the window's grid is laid out again when its size or scale changes,
+        // and the old position then names other cells, or none
+        if (target.board_w() != c.roi_board_w || target.board_h() != c.roi_board_h) {
+          return reply_(c, "err board resized since roi");
+        }
+        const LifeBoard cells = c.roi->cells();
+        for (int ry = 0; ry < cells.get_h(); ++ry) {
+          for (int rx = 0; rx < cells.get_w(); ++rx) { target.set_cell(c.roi_x + rx, c.roi_y + ry, cells.get(rx, ry)); }
+        }
+        c.roi.reset();
+        return reply_(c, "ok");
+      }
+      if (SDL_strcmp(sub, "discard") == 0) {
+        c.roi.reset();
+        return reply_(c, "ok");
+      }
+    }
+    return reply_(c, "err unknown command");
+  }
+
+  bool reply_(Client &c, const char *line) {
+    c.out += line;
+    c.out += '\n';
+    c.pending.pop_front();
+    return true;
+  }
+};
+
+#else
+
+class ControlServer {
+public:
+  bool listen(const char *) { SDL_Log("control: not supported on this platform"); return false; }
+  bool is_listening() const { return false; }
+  bool busy() const { return false; }
+  bool poll(ControlTarget &, Uint64 = 0) { return false; }
+};
+
+#endif
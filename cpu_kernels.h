@@ -0,0 +1,369 @@
+#pragma once
+// Hot bit-board kernels, compiled once per x86 instruction-set tier and picked
+// at startup from what the CPU reports, so one portable binary still runs its
+// inner loops on AVX2 or AVX-512 where the machine has them. Every tier gives
+// bit-identical results; --selftest checks each supported tier against the
+// generic one.
+//
+// AUTO_CELL_ISA=generic|sse4.2|avx2|avx512 caps the tier, for testing and for
+// comparing tiers. A tier the CPU lacks falls back to the best one below it.
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUTO_CELL_HAS_CPU_DISPATCH 1
+#define AUTO_CELL_KERNEL inline __attribute__((always_inline))
+#else
+#define AUTO_CELL_KERNEL inline
+#endif
+
+// splitmix64 finalizer, used for hashing and for position-seeded soups.
+inline uint64_t mix64(uint64_t x) {
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27; x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+// Hash contribution of one packed row at absolute row index y. Board hashes
+// are the wrapping sum of their rows, so bands hashed separately (threads,
+// shards) add up to the hash of the whole board.
+inline uint64_t hash_row(const uint64_t *row, int stride, int64_t y) {
+  uint64_t h {0};
+  bool any {false};
+  for (int k = 0; k < stride; ++k) {
+    any |= row[k] != 0;
+    h = mix64(h ^ row[k]) + static_cast<uint64_t>(k);
+  }
+  return any ? mix64(h ^ (static_cast<uint64_t>(y) * 0x9e3779b97f4a7c15ull)) : 0;
+}
+
+struct CpuKernels {
+  const char *name;
+  bool (*supported)();
+  // One packed row of the next generation; see step_row() in life_board.h.
+  void (*step_row)(const uint64_t *above, const uint64_t *center, const uint64_t *below,
+                   uint64_t *out, int stride, uint64_t tail_mask, uint16_t birth, uint16_t survive);
+  uint64_t (*popcount)(const uint64_t *words, size_t count);
+  // Sum of hash_row() over rows [y0, y1), row y hashed as y + y_offset.
+  uint64_t (*hash_rows)(const uint64_t *bits, int stride, int y0, int y1, int64_t y_offset);
+  // `groups` runs of 8 cells from column x0, each copied out of `table` as
+  // 8 * 3 * scale bytes (256 precomputed spans, scale <= 8). Scalar lookups in
+  // every tier; only the span copies get wider.
+  void (*expand_cells)(const uint64_t *row, int stride, int x0, int groups,
+                       const uint8_t *table, int scale, uint8_t *out);
+  // One row of a bit-sliced batch (batch_life.h): `cells` cells of `words`
+  // words each, bit k of word j belonging to board 64 * j + k. Rows start at
+  // their first cell and have a dead cell before and after. birth/survive
+  // hold 9 * words lane masks, one set per neighbor count. Lanes that differ
+  // from center (and from prev, the generation before) are ORed into
+  // changed (and changed2).
+  void (*step_sliced)(const uint64_t *above, const uint64_t *center, const uint64_t *below,
+                      const uint64_t *prev, uint64_t *out, int cells, int words,
+                      const uint64_t *birth, const uint64_t *survive, uint64_t *changed, uint64_t *changed2);
+};
+
+namespace kernel_detail {
+
+// Each kernel body is written once over a lane type V: uint64_t for the
+// generic tier, a GCC vector of 2/4/8 words for the SIMD tiers. Helpers take
+// and hand back vectors by reference, since passing one by value in code
+// built for the baseline ISA trips GCC's ABI warning.
+template <class V>
+AUTO_CELL_KERNEL void load(V &v, const uint64_t *p) { std::memcpy(&v, p, sizeof(v)); }
+
+// bit-sliced neighbor count: s3 s2 s1 s0
+template <class V>
+AUTO_CELL_KERNEL void count_add(V &s0, V &s1, V &s2, V &s3, const V &x) {
+  V c0 = s0 & x;  s0 ^= x;
+  V c1 = s1 & c0; s1 ^= c0;
+  V c2 = s2 & c1; s2 ^= c1;
+  s3 |= c2;
+}
+
+// Adds one row's contribution: the word's left and right neighbors, and the
+// word itself unless it is the center row.
+template <class V>
+AUTO_CELL_KERNEL void count_row(V &s0, V &s1, V &s2, V &s3, const V &w, const V &wl, const V &wr, bool center) {
+  count_add(s0, s1, s2, s3, (w << 1) | (wl >> 63));
+  count_add(s0, s1, s2, s3, (w >> 1) | (wr << 63));
+  if (!center) { count_add(s0, s1, s2, s3, w); }
+}
+
+// Next state of the cells in c given their neighbor counts.
+template <class V>
+AUTO_CELL_KERNEL void apply_rule(V &next, const V &s0, const V &s1, const V &s2, const V &s3, const V &c,
+                                 uint16_t birth, uint16_t survive) {
+  next = V {};
+  for (int n = 0; n <= 8; ++n) {
+    const uint16_t bit = static_cast<uint16_t>(1u << n);
+    if (!((birth | survive) & bit)) { continue; }
+    // flip each count bit that n has clear, so eq is all ones where count == n
+    const V eq = (s0 ^ (n & 1 ? 0 : ~0ull)) & (s1 ^ (n & 2 ? 0 : ~0ull)) &
+                 (s2 ^ (n & 4 ? 0 : ~0ull)) & (s3 ^ (n & 8 ? 0 : ~0ull));
+    if (birth & bit)   { next |= eq & ~c; }
+    if (survive & bit) { next |= eq & c; }
+  }
+}
+
+// Word k of a row, with the board edges and dead (nullptr) rows read as 0.
+AUTO_CELL_KERNEL uint64_t edge_word(const uint64_t *const rows[3], int k, int stride,
+                                    uint16_t birth, uint16_t survive) {
+  uint64_t s0 {0}, s1 {0}, s2 {0}, s3 {0};
+  for (int r = 0; r < 3; ++r) {
+    if (!rows[r]) { continue; }
+    const uint64_t wl = k > 0          ? rows[r][k - 1] : 0;
+    const uint64_t wr = k + 1 < stride ? rows[r][k + 1] : 0;
+    count_row(s0, s1, s2, s3, rows[r][k], wl, wr, r == 1);
+  }
+  uint64_t next;
+  apply_rule(next, s0, s1, s2, s3, rows[1][k], birth, survive);
+  return next;
+}
+
+// Words [k, k + lanes) of a row, all of which have both neighbor words.
+template <class V>
+AUTO_CELL_KERNEL void interior_words(const uint64_t *const rows[3], int k, uint64_t *out,
+                                     uint16_t birth, uint16_t survive) {
+  V s0 {}, s1 {}, s2 {}, s3 {};
+  for (int r = 0; r < 3; ++r) {
+    if (!rows[r]) { continue; }
+    V w, wl, wr;
+    load(w, rows[r] + k);
+    load(wl, rows[r] + k - 1);
+    load(wr, rows[r] + k + 1);
+    count_row(s0, s1, s2, s3, w, wl, wr, r == 1);
+  }
+  V c, next;
+  load(c, rows[1] + k);
+  apply_rule(next, s0, s1, s2, s3, c, birth, survive);
+  std::memcpy(out + k, &next, sizeof(next));
+}
+
+template <class V>
+AUTO_CELL_KERNEL void step_row_lanes(const uint64_t *above, const uint64_t *center, const uint64_t *below,
+                                     uint64_t *out, int stride, uint64_t tail_mask,
+                                     uint16_t birth, uint16_t survive) {
+  constexpr int kLanes = sizeof(V) / sizeof(uint64_t);
+  const uint64_t *const rows[3] {above, center, below};
+  if (kLanes > 1 && stride > kLanes + 1) {
+    // the last vector overlaps the one before rather than falling back to
+    // single words
+    out[0] = edge_word(rows, 0, stride, birth, survive);
+    for (int k = 1; k + kLanes < stride; k += kLanes) { interior_words<V>(rows, k, out, birth, survive); }
+    interior_words<V>(rows, stride - 1 - kLanes, out, birth, survive);
+    out[stride - 1] = edge_word(rows, stride - 1, stride, birth, survive);
+  } else {
+    for (int k = 0; k < stride; ++k) { out[k] = edge_word(rows, k, stride, birth, survive); }
+  }
+  out[stride - 1] &= tail_mask;
+}
+
+// step_sliced: every word is a cell of 64 boards, so neighbors are whole
+// words and need no shifting. Vectors span the words of one cell; cells whose
+// word count isn't a multiple of the vector go a word at a time.
+template <class V>
+AUTO_CELL_KERNEL void step_sliced_lanes(const uint64_t *above, const uint64_t *center, const uint64_t *below,
+                                        const uint64_t *prev, uint64_t *out, int cells, int words,
+                                        const uint64_t *birth, const uint64_t *survive,
+                                        uint64_t *changed, uint64_t *changed2) {
+  constexpr int kLanes = sizeof(V) / sizeof(uint64_t);
+  if constexpr (kLanes > 1) {
+    if (words % kLanes) {
+      step_sliced_lanes<uint64_t>(above, center, below, prev, out, cells, words, birth, survive, changed, changed2);
+      return;
+    }
+  }
+  const uint64_t *const rows[3] {above, center, below};
+  for (int k = 0; k < words; k += kLanes) {
+    V d1, d2;
+    load(d1, changed + k);
+    load(d2, changed2 + k);
+    for (int x = 0; x < cells; ++x) {
+      const size_t i = static_cast<size_t>(x) * words + k;
+      V s0 {}, s1 {}, s2 {}, s3 {};
+      for (int r = 0; r < 3; ++r) {
+        V v;
+        load(v, rows[r] + i - words);
+        count_add(s0, s1, s2, s3, v);
+        load(v, rows[r] + i + words);
+        count_add(s0, s1, s2, s3, v);
+        if (r != 1) {
+          load(v, rows[r] + i);
+          count_add(s0, s1, s2, s3, v);
+        }
+      }
+      V c, p;
+      load(c, center + i);
+      load(p, prev + i);
+      V next {};
+      for (int n = 0; n <= 8; ++n) {
+        const V eq = (s0 ^ (n & 1 ? 0 : ~0ull)) & (s1 ^ (n & 2 ? 0 : ~0ull)) &
+                     (s2 ^ (n & 4 ? 0 : ~0ull)) & (s3 ^ (n & 8 ? 0 : ~0ull));
+        V b, sv;
+        load(b, birth + static_cast<size_t>(n) * words + k);
+        load(sv, survive + static_cast<size_t>(n) * words + k);
+        next |= eq & ((b & ~c) | (sv & c));
+      }
+      std::memcpy(out + i, &next, sizeof(next));
+      d1 |= next ^ c;
+      d2 |= next ^ p;
+    }
+    std::memcpy(changed + k, &d1, sizeof(d1));
+    std::memcpy(changed2 + k, &d2, sizeof(d2));
+  }
+}
+
+AUTO_CELL_KERNEL uint64_t popcount_words(const uint64_t *words, size_t count) {
+  uint64_t n {0};
+  for (size_t i = 0; i < count; ++i) { n += static_cast<uint64_t>(__builtin_popcountll(words[i])); }
+  return n;
+}
+
+template <class V>
+AUTO_CELL_KERNEL void mix_lanes(V &x) {
+  x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27; x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+}
+
+// hash_row() for several rows at once, one row per lane.
+template <class V>
+AUTO_CELL_KERNEL uint64_t hash_rows_lanes(const uint64_t *bits, int stride, int y0, int y1, int64_t y_offset) {
+  constexpr int kLanes = sizeof(V) / sizeof(uint64_t);
+  uint64_t sum {0};
+  int y = y0;
+  if constexpr (kLanes > 1) {
+    for (; y + kLanes <= y1; y += kLanes) {
+      const uint64_t *first = bits + static_cast<size_t>(y) * stride;
+      V h {}, any {};
+      for (int k = 0; k < stride; ++k) {
+        V x;
+        for (int i = 0; i < kLanes; ++i) { x[i] = first[static_cast<size_t>(i) * stride + k]; }
+        any |= x;
+        h ^= x;
+        mix_lanes(h);
+        h += static_cast<uint64_t>(k);
+      }
+      for (int i = 0; i < kLanes; ++i) {
+        if (any[i]) { sum += mix64(h[i] ^ (static_cast<uint64_t>(y + i + y_offset) * 0x9e3779b97f4a7c15ull)); }
+      }
+    }
+  }
+  for (; y < y1; ++y) { sum += hash_row(bits + static_cast<size_t>(y) * stride, stride, y + y_offset); }
+  return sum;
+}
+
+// Eight cells starting at column x; bits past the board edge read as dead.
+AUTO_CELL_KERNEL unsigned cells8(const uint64_t *row, int stride, int x) {
+  const int w = x >> 6, b = x & 63;
+  uint64_t v = row[w] >> b;
+  if (b > 56 && w + 1 < stride) { v |= row[w + 1] << (64 - b); }
+  return static_cast<unsigned>(v & 0xff);
+}
+
+// A compile-time span size lets memcpy become a few wide moves.
+template <size_t Span>
+AUTO_CELL_KERNEL void expand_fixed(const uint64_t *row, int stride, int x0, int groups,
+                                   const uint8_t *table, uint8_t *out) {
+  for (int g = 0; g < groups; ++g, out += Span) {
+    std::memcpy(out, table + cells8(row, stride, x0 + 8 * g) * Span, Span);
+  }
+}
+
+AUTO_CELL_KERNEL void expand_cells_any(const uint64_t *row, int stride, int x0, int groups,
+                                       const uint8_t *table, int scale, uint8_t *out) {
+  switch (scale) {
+  case 1: expand_fixed<24>(row, stride, x0, groups, table, out); break;
+  case 2: expand_fixed<48>(row, stride, x0, groups, table, out); break;
+  case 3: expand_fixed<72>(row, stride, x0, groups, table, out); break;
+  case 4: expand_fixed<96>(row, stride, x0, groups, table, out); break;
+  case 5: expand_fixed<120>(row, stride, x0, groups, table, out); break;
+  case 6: expand_fixed<144>(row, stride, x0, groups, table, out); break;
+  case 7: expand_fixed<168>(row, stride, x0, groups, table, out); break;
+  default: expand_fixed<192>(row, stride, x0, groups, table, out); break;
+  }
+}
+
+// Stamps out the kernels of one tier, compiled for its target features.
+#define AUTO_CELL_KERNEL_TIER(tier, features, V)                                                             \
+  features inline void tier##_step_row(const uint64_t *a, const uint64_t *c, const uint64_t *b, uint64_t *out, \
+                                       int stride, uint64_t tail, uint16_t birth, uint16_t survive) {          \
+    step_row_lanes<V>(a, c, b, out, stride, tail, birth, survive);                                           \
+  }                                                                                                          \
+  features inline uint64_t tier##_popcount(const uint64_t *words, size_t count) {                            \
+    return popcount_words(words, count);                                                                     \
+  }                                                                                                          \
+  features inline uint64_t tier##_hash_rows(const uint64_t *bits, int stride, int y0, int y1, int64_t off) {  \
+    return hash_rows_lanes<V>(bits, stride, y0, y1, off);                                                    \
+  }                                                                                                          \
+  features inline void tier##_expand_cells(const uint64_t *row, int stride, int x0, int groups,              \
+                                           const uint8_t *table, int scale, uint8_t *out) {                  \
+    expand_cells_any(row, stride, x0, groups, table, scale, out);                                            \
+  }                                                                                                          \
+  features inline void tier##_step_sliced(const uint64_t *a, const uint64_t *c, const uint64_t *b,           \
+                                          const uint64_t *p, uint64_t *out, int cells, int words,            \
+                                          const uint64_t *birth, const uint64_t *survive,                    \
+                                          uint64_t *changed, uint64_t *changed2) {                           \
+    step_sliced_lanes<V>(a, c, b, p, out, cells, words, birth, survive, changed, changed2);                  \
+  }
+
+AUTO_CELL_KERNEL_TIER(generic, , uint64_t)
+
+#ifdef AUTO_CELL_HAS_CPU_DISPATCH
+using u64x2 = uint64_t __attribute__((vector_size(16)));
+using u64x4 = uint64_t __attribute__((vector_size(32)));
+using u64x8 = uint64_t __attribute__((vector_size(64)));
+
+AUTO_CELL_KERNEL_TIER(sse42,  __attribute__((target("sse4.2,popcnt"))), u64x2)
+AUTO_CELL_KERNEL_TIER(avx2,   __attribute__((target("avx2,bmi2,popcnt"))), u64x4)
+AUTO_CELL_KERNEL_TIER(avx512, __attribute__((target("avx512f,avx512bw,avx512vl,avx512dq,avx2,bmi2,popcnt"))), u64x8)
+#endif
+
+#undef AUTO_CELL_KERNEL_TIER
+
+}  // namespace kernel_detail
+
+// Every tier this build has, slowest first. Each tier's CPU requirements
+// include those of the tiers before it.
+inline const std::vector<CpuKernels> &cpu_kernel_tiers() {
+  using namespace kernel_detail;
+  static const std::vector<CpuKernels> tiers {
+    {"generic", [] { return true; }, generic_step_row, generic_popcount, generic_hash_rows, generic_expand_cells,
+     generic_step_sliced},
+#ifdef AUTO_CELL_HAS_CPU_DISPATCH
+    {"sse4.2", [] { return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("popcnt"); },
+     sse42_step_row, sse42_popcount, sse42_hash_rows, sse42_expand_cells, sse42_step_sliced},
+    {"avx2", [] { return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi2"); },
+     avx2_step_row, avx2_popcount, avx2_hash_rows, avx2_expand_cells, avx2_step_sliced},
+    {"avx512", [] {
+       return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+              __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+     },
+     avx512_step_row, avx512_popcount, avx512_hash_rows, avx512_expand_cells, avx512_step_sliced},
+#endif
+  };
+  return tiers;
+}
+
+// The tier in use: the best one the CPU supports, capped by AUTO_CELL_ISA.
+inline const CpuKernels &cpu_kernels() {
+  static const CpuKernels &selected = [] () -> const CpuKernels & {
+#ifdef AUTO_CELL_HAS_CPU_DISPATCH
+    __builtin_cpu_init();
+#endif
+    const char *cap = std::getenv("AUTO_CELL_ISA");
+    const std::vector<CpuKernels> &tiers = cpu_kernel_tiers();
+    const CpuKernels *best = &tiers.front();
+    for (const CpuKernels &k : tiers) {
+      if (!k.supported()) { break; }
+      best = &k;
+      if (cap && std::strcmp(cap, k.name) == 0) { break; }
+    }
+    return *best;
+  }();
+  return selected;
+}
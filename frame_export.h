@@ -0,0 +1,416 @@
+#pragma once
+// Renders the packed board, or a region of it, to RGB frames at any integer
+// scale without going through the window: PNG files for stills and
+// timelapses, or raw rgb24 frames piped into an encoder such as ffmpeg.
+//
+// Bits are expanded eight cells at a time through a per-style lookup table of
+// ready-made pixel spans, scaled rows are duplicated with memcpy, and each
+// worker renders and deflates its own band of rows. The expansion is a scalar
+// table lookup and copy, not SIMD code; cpu_kernels.h builds it once per
+// instruction-set tier only so the fixed-size span copies can use that tier's
+// widest moves. Bands end on a byte
+// boundary (an empty stored block, like zlib's sync flush), so they are
+// simply concatenated into the PNG's single IDAT stream.
+//
+// The deflate coder is deliberately small: fixed Huffman codes, and matches
+// only against the previous pixel or the previous scanline, which is where
+// all the redundancy in a cell image is.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cpu_kernels.h"
+#include "parallel.h"
+#include "sim_hooks.h"
+
+// Cells to render. A zero width or height means "to the edge of the board".
+struct FrameRegion {
+  int x {0};
+  int y {0};
+  int w {0};
+  int h {0};
+};
+
+struct FrameStyle {
+  int     scale {4};                 // pixels per cell along each axis
+  uint8_t alive[3] {97, 175, 239};   // the window's active cell colour
+  uint8_t dead[3]  {0, 0, 0};
+};
+
+namespace frame_detail {
+
+constexpr int kMaxPixels = 1 << 20;  // per axis
+constexpr int64_t kMaxBytes = int64_t {1} << 29;  // rgb24 bytes per frame, about 13k x 13k
+
+// Pixel spans for every combination of eight cells, plus one-cell spans for
+// row tails and scales too large to tabulate.
+struct PixelLut {
+  int scale {1};
+  size_t cell_bytes {3};
+  std::vector<uint8_t> alive;
+  std::vector<uint8_t> dead;
+  std::vector<uint8_t> table;  // 256 entries of 8 * cell_bytes, empty if scale > 8
+
+  explicit PixelLut(const FrameStyle &style) : scale{style.scale}, cell_bytes{static_cast<size_t>(style.scale) * 3} {
+    for (int i = 0; i < scale; ++i) {
+      alive.insert(alive.end(), style.alive, style.alive + 3);
+      dead.insert(dead.end(), style.dead, style.dead + 3);
+    }
+    if (scale > 8) { return; }
+    table.resize(256 * 8 * cell_bytes);
+    for (int v = 0; v < 256; ++v) {
+      uint8_t *p = table.data() + static_cast<size_t>(v) * 8 * cell_bytes;
+      for (int b = 0; b < 8; ++b, p += cell_bytes) {
+        std::memcpy(p, ((v >> b) & 1) ? alive.data() : dead.data(), cell_bytes);
+      }
+    }
+  }
+};
+
+// One pixel row for cells [x0, x0 + w) of a board row.
+inline void expand_row(const BoardView &view, int y, int x0, int w, const PixelLut &lut, uint8_t *out) {
+  const uint64_t *row = view.row(y);
+  int x = 0;
+  if (!lut.table.empty()) {
+    cpu_kernels().expand_cells(row, view.stride, x0, w / 8, lut.table.data(), lut.scale, out);
+    x = w / 8 * 8;
+    out += static_cast<size_t>(x) * lut.cell_bytes;
+  }
+  for (; x < w; ++x, out += lut.cell_bytes) {
+    const int cx = x0 + x;
+    std::memcpy(out, ((row[cx >> 6] >> (cx & 63)) & 1) ? lut.alive.data() : lut.dead.data(), lut.cell_bytes);
+  }
+}
+
+// Renders cell rows [y0, y1) of the region as scaled scanlines `pitch` bytes
+// apart, each starting `lead` bytes in (PNG rows carry a filter byte there).
+inline void render_rows(const BoardView &view, const FrameRegion &r, const PixelLut &lut,
+                        int y0, int y1, size_t pitch, size_t lead, uint8_t *out) {
+  const size_t row_bytes = static_cast<size_t>(r.w) * lut.cell_bytes;
+  for (int y = y0; y < y1; ++y) {
+    uint8_t *first = out + static_cast<size_t>(y - y0) * lut.scale * pitch;
+    if (lead) { std::memset(first, 0, lead); }
+    expand_row(view, r.y + y, r.x, r.w, lut, first + lead);
+    for (int s = 1; s < lut.scale; ++s) { std::memcpy(first + s * pitch, first, lead + row_bytes); }
+  }
+}
+
+inline uint32_t crc32(const uint8_t *p, size_t n, uint32_t crc = 0) {
+  static const std::vector<uint32_t> table = [] {
+    std::vector<uint32_t> t(256);
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) { c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1; }
+      t[i] = c;
+    }
+    return t;
+  }();
+  crc = ~crc;
+  for (size_t i = 0; i < n; ++i) { crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8); }
+  return ~crc;
+}
+
+constexpr uint32_t kAdlerBase = 65521;
+
+inline uint32_t adler32(const uint8_t *p, size_t n) {
+  uint32_t a {1}, b {0};
+  while (n > 0) {
+    size_t chunk = n < 5552 ? n : 5552;  // largest run that cannot overflow
+    n -= chunk;
+    for (; chunk > 0; --chunk) { a += *p++; b += a; }
+    a %= kAdlerBase;
+    b %= kAdlerBase;
+  }
+  return (b << 16) | a;
+}
+
+// Checksum of A followed by B, given both checksums and B's length (as zlib).
+inline uint32_t adler32_combine(uint32_t a1, uint32_t a2, size_t len2) {
+  const uint32_t rem = static_cast<uint32_t>(len2 % kAdlerBase);
+  uint32_t sum1 = a1 & 0xffff;
+  uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % kAdlerBase);
+  sum1 += (a2 & 0xffff) + kAdlerBase - 1;
+  sum2 += ((a1 >> 16) & 0xffff) + ((a2 >> 16) & 0xffff) + kAdlerBase - rem;
+  if (sum1 >= kAdlerBase) { sum1 -= kAdlerBase; }
+  if (sum1 >= kAdlerBase) { sum1 -= kAdlerBase; }
+  if (sum2 >= (kAdlerBase << 1)) { sum2 -= (kAdlerBase << 1); }
+  if (sum2 >= kAdlerBase) { sum2 -= kAdlerBase; }
+  return sum1 | (sum2 << 16);
+}
+
+class BitWriter {
+public:
+  explicit BitWriter(std::vector<uint8_t> &out) : out_{out} {}
+
+  void put(uint32_t bits, int count) {  // LSB first
+    acc_ |= static_cast<uint64_t>(bits) << used_;
+    used_ += count;
+    while (used_ >= 8) { out_.push_back(static_cast<uint8_t>(acc_)); acc_ >>= 8; used_ -= 8; }
+  }
+  void put_code(uint32_t code, int count) {  // Huffman codes go MSB first
+    uint32_t rev {0};
+    for (int i = 0; i < count; ++i) { rev = (rev << 1) | ((code >> i) & 1); }
+    put(rev, count);
+  }
+  void align() { if (used_ > 0) { put(0, 8 - used_); } }
+
+private:
+  std::vector<uint8_t> &out_;
+  uint64_t acc_ {0};
+  int used_ {0};
+};
+
+inline void put_symbol(BitWriter &bw, int sym) {
+  if (sym < 144)      { bw.put_code(0x30 + sym, 8); }
+  else if (sym < 256) { bw.put_code(0x190 + sym - 144, 9); }
+  else if (sym < 280) { bw.put_code(sym - 256, 7); }
+  else                { bw.put_code(0xc0 + sym - 280, 8); }
+}
+
+inline void put_match(BitWriter &bw, int length, int distance) {
+  static const uint16_t kLenBase[29]  {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                       35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+  static const uint8_t  kLenExtra[29] {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                       3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+  static const uint16_t kDistBase[30] {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                       8193, 12289, 16385, 24577};
+  int lc = 28;
+  while (kLenBase[lc] > length) { --lc; }
+  put_symbol(bw, 257 + lc);
+  bw.put(static_cast<uint32_t>(length - kLenBase[lc]), kLenExtra[lc]);
+  int dc = 29;
+  while (kDistBase[dc] > distance) { --dc; }
+  bw.put_code(static_cast<uint32_t>(dc), 5);
+  bw.put(static_cast<uint32_t>(distance - kDistBase[dc]), dc < 4 ? 0 : dc / 2 - 1);
+}
+
+// Deflates one self-contained band as a non-final fixed-Huffman block,
+// followed by an empty stored block to reach a byte boundary.
+inline void deflate_band(const uint8_t *data, size_t n, size_t pitch, std::vector<uint8_t> &out) {
+  BitWriter bw(out);
+  bw.put(0, 1);  // BFINAL
+  bw.put(1, 2);  // fixed Huffman
+  const size_t dists[2] {3, pitch <= 32768 ? pitch : 0};
+  size_t i {0};
+  while (i < n) {
+    const size_t limit = std::min<size_t>(258, n - i);
+    size_t best_len {0}, best_dist {0};
+    for (size_t d : dists) {
+      if (d == 0 || d > i) { continue; }
+      size_t len {0};
+      while (len < limit && data[i + len] == data[i + len - d]) { ++len; }
+      if (len > best_len) { best_len = len; best_dist = d; }
+    }
+    if (best_len >= 3) {
+      put_match(bw, static_cast<int>(best_len), static_cast<int>(best_dist));
+      i += best_len;
+    } else {
+      put_symbol(bw, data[i++]);
+    }
+  }
+  put_symbol(bw, 256);
+  bw.put(0, 3);  // empty stored block: BFINAL 0, type 00, then LEN/NLEN
+  bw.align();
+  out.insert(out.end(), {0x00, 0x00, 0xff, 0xff});
+}
+
+inline void put_be32(std::vector<char> &out, uint32_t v) {
+  const char b[4] {static_cast<char>(v >> 24), static_cast<char>(v >> 16), static_cast<char>(v >> 8), static_cast<char>(v)};
+  out.insert(out.end(), b, b + 4);
+}
+
+inline void put_chunk(std::vector<char> &out, const char type[4], const uint8_t *data, size_t n) {
+  put_be32(out, static_cast<uint32_t>(n));
+  const size_t at = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + n);
+  put_be32(out, crc32(reinterpret_cast<const uint8_t *>(out.data() + at), n + 4));
+}
+
+}  // namespace frame_detail
+
+// Clips region to the board and checks the scaled size. Returns false if empty or too large.
+inline bool frame_resolve(const BoardView &view, const FrameStyle &style, FrameRegion &r) {
+  if (r.w <= 0) { r.w = view.width - r.x; }
+  if (r.h <= 0) { r.h = view.height - r.y; }
+  const int x1 = std::min(r.x + r.w, view.width), y1 = std::min(r.y + r.h, view.height);
+  r.x = std::max(r.x, 0);
+  r.y = std::max(r.y, 0);
+  r.w = x1 - r.x;
+  r.h = y1 - r.y;
+  return style.scale >= 1 && r.w > 0 && r.h > 0 &&
+         static_cast<int64_t>(r.w) * style.scale <= frame_detail::kMaxPixels &&
+         static_cast<int64_t>(r.h) * style.scale <= frame_detail::kMaxPixels &&
+         static_cast<int64_t>(r.w) * style.scale * r.h * style.scale * 3 <= frame_detail::kMaxBytes;
+}
+
+// Raw rgb24 pixels, rows top to bottom with no padding.
+inline bool render_rgb(const BoardView &view, FrameRegion region, const FrameStyle &style, std::vector<uint8_t> &out) {
+  if (!frame_resolve(view, style, region)) { return false; }
+  const frame_detail::PixelLut lut(style);
+  const size_t pitch = static_cast<size_t>(region.w) * lut.cell_bytes;
+  out.resize(pitch * static_cast<size_t>(region.h) * style.scale);
+  parallel_for(0, region.h, 16, [&](int y0, int y1) {
+    frame_detail::render_rows(view, region, lut, y0, y1, pitch, 0,
+                              out.data() + static_cast<size_t>(y0) * style.scale * pitch);
+  });
+  return true;
+}
+
+// A complete PNG file (8-bit RGB). Empty if the region is empty or too large.
+inline std::vector<char> encode_png(const BoardView &view, FrameRegion region, const FrameStyle &style) {
+  using namespace frame_detail;
+  std::vector<char> png;
+  if (!frame_resolve(view, style, region)) { return png; }
+  const PixelLut lut(style);
+  const uint32_t width  = static_cast<uint32_t>(region.w * style.scale);
+  const uint32_t height = static_cast<uint32_t>(region.h * style.scale);
+  const size_t pitch = 1 + static_cast<size_t>(width) * 3;
+
+  struct Band { int y0, y1; std::vector<uint8_t> z; uint32_t adler; size_t raw; };
+  std::vector<Band> bands;
+  const int count = std::max(1, std::min(worker_count() * 2, region.h));
+  for (int i = 0; i < count; ++i) {
+    bands.push_back({region.h * i / count, region.h * (i + 1) / count, {}, 1, 0});
+  }
+  parallel_for(0, count, 1, [&](int b0, int b1) {
+    std::vector<uint8_t> raw;
+    for (int b = b0; b < b1; ++b) {
+      Band &band = bands[static_cast<size_t>(b)];
+      band.raw = static_cast<size_t>(band.y1 - band.y0) * style.scale * pitch;
+      raw.resize(band.raw);
+      render_rows(view, region, lut, band.y0, band.y1, pitch, 1, raw.data());
+      band.adler = adler32(raw.data(), raw.size());
+      deflate_band(raw.data(), raw.size(), pitch, band.z);
+    }
+  });
+
+  std::vector<uint8_t> idat {0x78, 0x01};
+  uint32_t adler {1};
+  for (const Band &band : bands) {
+    idat.insert(idat.end(), band.z.begin(), band.z.end());
+    adler = adler32_combine(adler, band.adler, band.raw);
+  }
+  idat.insert(idat.end(), {0x03, 0x00});  // empty final block
+  idat.insert(idat.end(), {static_cast<uint8_t>(adler >> 24), static_cast<uint8_t>(adler >> 16),
+                           static_cast<uint8_t>(adler >> 8), static_cast<uint8_t>(adler)});
+
+  const uint8_t ihdr[13] {static_cast<uint8_t>(width >> 24), static_cast<uint8_t>(width >> 16),
+                          static_cast<uint8_t>(width >> 8), static_cast<uint8_t>(width),
+                          static_cast<uint8_t>(height >> 24), static_cast<uint8_t>(height >> 16),
+                          static_cast<uint8_t>(height >> 8), static_cast<uint8_t>(height),
+                          8, 2, 0, 0, 0};
+  static const char kSignature[8] {'\x89', 'P', 'N', 'G', '\r', '\n', '\x1a', '\n'};
+  png.insert(png.end(), kSignature, kSignature + 8);
+  put_chunk(png, "IHDR", ihdr, sizeof(ihdr));
+  put_chunk(png, "IDAT", idat.data(), idat.size());
+  put_chunk(png, "IEND", nullptr, 0);
+  return png;
+}
+
+// The board rows a frame covers, copied so it can be encoded on another
+// thread while the board keeps stepping. view covers only those rows, and
+// region is relative to it.
+struct FrameRows {
+  std::vector<uint64_t> bits;
+  BoardView   view;
+  FrameRegion region;
+};
+
+// Returns false if the region is empty or too large.
+inline bool copy_frame_rows(const BoardView &view, FrameRegion region, const FrameStyle &style, FrameRows &out) {
+  if (!frame_resolve(view, style, region)) { return false; }
+  out.bits.assign(view.row(region.y), view.row(region.y + region.h));
+  out.view   = {out.bits.data(), view.width, region.h, view.stride, view.generation};
+  out.region = {region.x, 0, region.w, region.h};
+  return true;
+}
+
+// Bounds the frames handed to another thread for encoding: acquire() blocks
+// while `slots` are taken, and the encoder calls release() when it is done
+// with one, so a stepper that outruns the encoder waits instead of queueing
+// board copies without limit.
+class FrameBacklog {
+public:
+  explicit FrameBacklog(int slots) : free_{slots} {}
+  FrameBacklog(const FrameBacklog&) = delete;
+
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    freed_.wait(lock, [this] { return free_ > 0; });
+    --free_;
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++free_;
+    }
+    freed_.notify_one();
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable freed_;
+  int free_;
+};
+
+// Raw rgb24 frames written to a shell command's stdin, e.g.
+//   ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r 30 -i - out.mp4
+// A blocked encoder blocks the caller, so frames are never dropped.
+class FramePipe {
+public:
+  FramePipe() = default;
+  FramePipe(const FramePipe&) = delete;
+  ~FramePipe() { close(); }
+
+  bool open(const char *command) {
+#if defined(_WIN32)
+    pipe_ = _popen(command, "wb");
+#else
+    pipe_ = popen(command, "w");
+#endif
+    if (!pipe_) { SDL_Log("frames: cannot start %s", command); }
+    return pipe_ != nullptr;
+  }
+
+  bool is_open() const { return pipe_ != nullptr; }
+
+  bool write(const BoardView &view, const FrameRegion &region, const FrameStyle &style) {
+    if (!pipe_ || !render_rgb(view, region, style, pixels_)) { return false; }
+    if (pixels_.size() != frame_bytes_) {
+      if (frame_bytes_ != 0) { SDL_Log("frames: frame size changed, encoder input is now inconsistent"); }
+      frame_bytes_ = pixels_.size();
+      FrameRegion r {region};
+      frame_resolve(view, style, r);
+      SDL_Log("frames: piping %dx%d rgb24", r.w * style.scale, r.h * style.scale);
+    }
+    if (std::fwrite(pixels_.data(), 1, pixels_.size(), pipe_) != pixels_.size()) {
+      SDL_Log("frames: encoder stopped accepting frames");
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  void close() {
+    if (!pipe_) { return; }
+#if defined(_WIN32)
+    _pclose(pipe_);
+#else
+    pclose(pipe_);
+#endif
+    pipe_ = nullptr;
+  }
+
+private:
+  FILE *pipe_ {nullptr};
+  std::vector<uint8_t> pixels_;
+  size_t frame_bytes_ {0};
+};
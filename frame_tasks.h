@@ -0,0 +1,177 @@
+#pragma once
+// Cooperative tasks for the window's main thread.
+//
+// A Task is a C++20 coroutine that does a long job (loading a pattern,
+// jumping ahead many generations, exporting the board) a piece at a time.
+// SDL_AppIterate calls FrameScheduler::run() once per frame with a time
+// budget; runnable tasks are resumed in turn until it is spent, and the rest
+// continue on the next frame. Everything runs on the main thread, so a task
+// may touch the board freely between suspension points, but must expect
+// input and other tasks to have changed it across one.
+//
+// Inside a task:
+//   co_await sched.yield();              continue now if budget is left, else next frame
+//   co_await sched.next_frame();         continue next frame
+//   IoResult r = co_await sched.read(io, path);
+//   IoResult r = co_await sched.write(io, path, data);
+// I/O tasks resume from the completion callback, i.e. inside
+// AsyncIo::poll_completions(), which must also run on the main thread.
+#include <SDL3/SDL.h>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <list>
+#include <string>
+#include <utility>
+#include <vector>
+#include "async_io.h"
+
+class Task {
+public:
+  struct promise_type {
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    // a task doesn't start until the scheduler first resumes it
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task() = default;
+  Task(Task &&o) noexcept : handle_{std::exchange(o.handle_, nullptr)} {}
+  Task &operator=(Task &&o) noexcept {
+    if (this != &o) {
+      reset_();
+      handle_ = std::exchange(o.handle_, nullptr);
+    }
+    return *this;
+  }
+  Task(const Task &) = delete;
+  Task &operator=(const Task &) = delete;
+  ~Task() { reset_(); }
+
+  std::coroutine_handle<> handle() const { return handle_; }
+  bool done() const { return !handle_ || handle_.done(); }
+
+private:
+  explicit Task(std::coroutine_handle<promise_type> h) : handle_{h} {}
+  void reset_() {
+    if (handle_) { handle_.destroy(); }
+    handle_ = nullptr;
+  }
+
+  std::coroutine_handle<promise_type> handle_ {nullptr};
+};
+
+class FrameScheduler {
+public:
+  FrameScheduler() = default;
+  FrameScheduler(const FrameScheduler &) = delete;
+
+  // Takes ownership of task; it first runs on the next run().
+  void spawn(const char *name, Task task) {
+    if (task.done()) { return; }
+    std::coroutine_handle<> h = task.handle();
+    tasks_.push_back({name, std::move(task)});
+    later_.push_back(h);
+  }
+
+  // Resumes tasks until budget_ms has passed or none can run this frame.
+  // Returns how many tasks are still alive.
+  size_t run(double budget_ms) {
+    const Uint64 start = SDL_GetPerformanceCounter();
+    deadline_ = start + static_cast<Uint64>(budget_ms * 1e-3 * static_cast<double>(SDL_GetPerformanceFrequency()));
+    for (std::coroutine_handle<> h : later_) { ready_.push_back(h); }
+    later_.clear();
+    while (!ready_.empty()) {
+      std::coroutine_handle<> h = ready_.front();
+      ready_.pop_front();
+      h.resume();
+      if (h.done()) { finish_(h); }
+      if (over_budget()) { break; }
+    }
+    // whatever didn't get its turn goes first next frame
+    for (std::coroutine_handle<> h : ready_) { later_.push_back(h); }
+    ready_.clear();
+    return tasks_.size();
+  }
+
+  bool idle() const { return tasks_.empty(); }
+  // Some task can run next frame; false when all are waiting on I/O.
+  bool runnable() const { return !ready_.empty() || !later_.empty(); }
+  size_t size() const { return tasks_.size(); }
+  bool over_budget() const { return SDL_GetPerformanceCounter() >= deadline_; }
+
+  // Destroys every task, suspended wherever it is. Pending I/O callbacks
+  // must not run afterwards, so stop the AsyncIo first.
+  void clear() {
+    for (const Entry &e : tasks_) { SDL_Log("tasks: dropping unfinished %s", e.name); }
+    ready_.clear();
+    later_.clear();
+    tasks_.clear();
+  }
+
+  // Awaitables.
+  struct Yield {
+    FrameScheduler &s;
+    // keeps going while there's time and nothing else waiting for a turn
+    bool await_ready() const { return !s.over_budget() && s.ready_.empty(); }
+    void await_suspend(std::coroutine_handle<> h) { (s.over_budget() ? s.later_ : s.ready_).push_back(h); }
+    void await_resume() const {}
+  };
+  struct NextFrame {
+    FrameScheduler &s;
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) { s.later_.push_back(h); }
+    void await_resume() const {}
+  };
+  struct Io {
+    FrameScheduler &s;
+    AsyncIo &io;
+    std::string path;
+    std::vector<char> data;
+    bool write;
+    IoResult result {};
+
+    bool await_ready() const { return false; }
+    void await_suspend(std::coroutine_handle<> h) {
+      IoCallback done = [this, h](IoResult &r) {
+        result = std::move(r);
+        s.ready_.push_back(h);
+      };
+      if (write) {
+        io.write_file(std::move(path), std::move(data), std::move(done));
+      } else {
+        io.read_file(std::move(path), std::move(done));
+      }
+    }
+    IoResult await_resume() { return std::move(result); }
+  };
+
+  Yield yield() { return {*this}; }
+  NextFrame next_frame() { return {*this}; }
+  Io read(AsyncIo &io, std::string path) { return {*this, io, std::move(path), {}, false}; }
+  Io write(AsyncIo &io, std::string path, std::vector<char> data) {
+    return {*this, io, std::move(path), std::move(data), true};
+  }
+
+private:
+  struct Entry {
+    const char *name;
+    Task task;
+  };
+
+  std::list<Entry> tasks_;
+  std::deque<std::coroutine_handle<>> ready_;  // runnable this frame
+  std::deque<std::coroutine_handle<>> later_;  // runnable from the next frame
+  Uint64 deadline_ {0};
+
+  void finish_(std::coroutine_handle<> h) {
+    for (auto it = tasks_.begin(); it != tasks_.end(); ++it) {
+      if (it->task.handle() == h) {
+        tasks_.erase(it);
+        return;
+      }
+    }
+  }
+};
@@ -0,0 +1,21 @@
+// libFuzzer target for the checkpoint reader (checkpoint.h); see
+// AUTO_CELL_FUZZ in CMakeLists.txt. Whatever parses must keep the cells past
+// the width dead and serialize back to the same bytes.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "checkpoint.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  LifeBoard board;
+  Rule rule;
+  uint64_t generation {0};
+  if (!parse_checkpoint(reinterpret_cast<const char *>(data), size, board, rule, generation)) { return 0; }
+  for (int y = 0; y < board.get_h(); ++y) {
+    if (board.row(y)[board.get_stride() - 1] & ~board.tail_mask()) { __builtin_trap(); }
+  }
+  const std::vector<char> again = serialize_checkpoint(board.snapshot(), rule, generation);
+  if (again.size() != size || std::memcmp(again.data(), data, size) != 0) { __builtin_trap(); }
+  return 0;
+}
@@ -0,0 +1,20 @@
+// libFuzzer target for the control protocol (control_server.h); see
+// AUTO_CELL_FUZZ in CMakeLists.txt. The input is fed as one client's stream,
+// without a socket, to a small board; every command must get one reply line.
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "control_server.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+#if defined(AUTO_CELL_HAS_CONTROL)
+  static ControlServer server;
+  BoardTarget target {LifeBoard(64, 48)};
+  const std::string replies = server.run_script(target, reinterpret_cast<const char *>(data), size, 50000000);
+  if (!replies.empty() && replies.back() != '\n') { __builtin_trap(); }
+#else
+  (void)data;
+  (void)size;
+#endif
+  return 0;
+}
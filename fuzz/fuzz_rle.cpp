@@ -0,0 +1,30 @@
+// libFuzzer target for the RLE reader (pattern_io.h); see AUTO_CELL_FUZZ in
+// CMakeLists.txt. Whatever parses must fit the limits and come back the same
+// through write_rle().
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "pattern_io.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  PatternLimits limits;
+  limits.max_width  = 4096;  // small enough that a run stays fast
+  limits.max_height = 4096;
+  limits.max_cells  = int64_t {1} << 22;
+  LifeBoard board;
+  Rule rule;
+  std::string error;
+  if (!parse_rle(reinterpret_cast<const char *>(data), size, board, &rule, &error, limits)) { return 0; }
+  if (board.get_w() > limits.max_width || board.get_h() > limits.max_height ||
+      static_cast<int64_t>(board.get_w()) * board.get_h() > limits.max_cells) {
+    __builtin_trap();
+  }
+  const std::string again = write_rle(board, rule);
+  LifeBoard back;
+  Rule back_rule;
+  if (!parse_rle(again.data(), again.size(), back, &back_rule, &error, limits) || !(back_rule == rule) ||
+      back.get_w() != board.get_w() || back.get_h() != board.get_h() || back.hash() != board.hash()) {
+    __builtin_trap();
+  }
+  return 0;
+}
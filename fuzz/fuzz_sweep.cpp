@@ -0,0 +1,20 @@
+// libFuzzer target for the rule sweep file reader (rule_sweep.h); see
+// AUTO_CELL_FUZZ in CMakeLists.txt. Whatever parses must hold valid rules and
+// classes and serialize back to the same bytes.
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "rule_sweep.h"
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  SweepResults res;
+  SweepOptions opt;
+  if (!parse_sweep(reinterpret_cast<const char *>(data), size, res, opt)) { return 0; }
+  for (size_t i = 0; i < res.rows(); ++i) {
+    if (res.behavior[i] >= kSweepClasses || res.rule[i] >= (1u << 18)) { __builtin_trap(); }
+  }
+  const std::vector<char> again = serialize_sweep(res, opt);
+  if (again.size() != size || std::memcmp(again.data(), data, size) != 0) { __builtin_trap(); }
+  return 0;
+}
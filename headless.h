@@ -0,0 +1,145 @@
+#pragma once
+// Single-process headless run: steps a packed soup as fast as possible and,
+// if asked, publishes frames into a shared-memory ring for live viewers.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "band_pool.h"
+#include "change_list.h"
+#include "checkpoint.h"
+#include "life_board.h"
+#include "shm_ring.h"
+#include "sim_hooks.h"
+#include "temporal.h"
+
+struct HeadlessOptions {
+  int         width       {1024};
+  int         height      {1024};
+  int         generations {100};     // <= 0 runs until killed
+  uint64_t    seed        {1};
+  int         density     {35};
+  const char *publish     {nullptr}; // shared-memory ring name, e.g. "/auto_cell"
+  int         publish_hz  {60};
+  HookRegistry *hooks     {nullptr}; // per-generation callbacks, may be null
+  Checkpointer *checkpoints {nullptr}; // periodic saves, may be null
+  const char *restore     {nullptr}; // checkpoint directory to resume from
+  int         threads     {0};       // 0: parallel_for backend, 1: serial, > 1: pinned band workers
+  int         block       {1};       // > 1 advances up to this many generations per pass
+  bool        sparse      {false};   // step only around last generation's changes (change_list.h)
+};
+
+inline int run_headless(const HeadlessOptions &opt) {
+  if (opt.width < 1 || opt.height < 1) {
+    SDL_Log("headless: bad board size %dx%d", opt.width, opt.height);
+    return 1;
+  }
+  Rule rule {};
+  uint64_t gen {0};
+  // a resumed run keeps counting from the checkpoint, so --gens stays the total
+  LifeBoard restored;
+  const bool resumed = opt.restore && Checkpointer::restore_latest(opt.restore, restored, rule, gen);
+  const int width  = resumed ? restored.get_w() : opt.width;
+  const int height = resumed ? restored.get_h() : opt.height;
+
+  std::unique_ptr<BandPool> pool;
+  LifeBoard board;
+  if (opt.threads > 1) {
+    // the workers write each band first, so its pages live on their node
+    pool = std::make_unique<BandPool>(height, opt.threads);
+    board = LifeBoard(width, height, LifeBoard::Untouched {});
+    pool->place(board);
+    SDL_Log("headless: %d workers on %d NUMA node%s", pool->workers(), pool->node_count(),
+            pool->node_count() == 1 ? "" : "s");
+  } else {
+    board = resumed ? std::move(restored) : LifeBoard(width, height);
+  }
+  if (resumed && pool) {
+    for (int y = 0; y < height; ++y) {
+      std::memcpy(board.row(y), restored.row(y), static_cast<size_t>(board.get_stride()) * sizeof(uint64_t));
+    }
+  } else if (!resumed) {
+    board.fill_random(opt.seed, opt.density);
+  }
+  const uint64_t first_gen {gen};
+  if (opt.hooks) { opt.hooks->start(first_gen); }
+  if (opt.checkpoints) { opt.checkpoints->start(first_gen); }
+
+  ShmRingWriter ring;
+  if (opt.publish && !ring.open(opt.publish, board)) { return 1; }
+
+  // frames are copied out at most publish_hz times a second, so viewers never
+  // throttle the stepper
+  const Uint64 frequency = SDL_GetPerformanceFrequency();
+  const Uint64 interval  = opt.publish_hz > 0 ? frequency / static_cast<Uint64>(opt.publish_hz) : 0;
+  const Uint64 start     = SDL_GetPerformanceCounter();
+  Uint64 next_publish {start};
+
+  ChangeListStepper changes;
+  bool sparse = opt.sparse;
+  if (sparse && !ChangeListStepper::supports(rule)) {
+    SDL_Log("headless: --sparse can't run rules with B0; stepping the whole board");
+    sparse = false;
+  }
+  if (sparse) { changes.reset(board); }
+
+  // tile buffers per worker, kept across blocked passes
+  std::vector<TemporalScratch> scratch(static_cast<size_t>(pool ? pool->workers() : worker_count()));
+  while (opt.generations <= 0 || gen < static_cast<uint64_t>(opt.generations)) {
+    // a blocked pass never jumps over a generation a hook wants to see
+    uint64_t depth = opt.block > 1 && !sparse ? static_cast<uint64_t>(opt.block) : 1;
+    if (opt.generations > 0) { depth = std::min(depth, static_cast<uint64_t>(opt.generations) - gen); }
+    if (opt.hooks) { depth = opt.hooks->next_due() > gen ? std::min(depth, opt.hooks->next_due() - gen) : 1; }
+    const int d = static_cast<int>(depth);
+    if (sparse) {
+      changes.step(board, rule);
+    } else if (d > 1 && pool) {
+      pool->run([&](int w, int y0, int y1) { step_ahead(board, rule, d, y0, y1, scratch[static_cast<size_t>(w)]); });
+      board.swap_generation();
+    } else if (d > 1 && opt.threads == 1) {
+      step_ahead(board, rule, d, 0, board.get_h(), scratch[0]);
+      board.swap_generation();
+    } else if (d > 1) {
+      parallel_for_slices(0, board.get_h(), temporal_tile_rows(board.get_stride(), d), [&](int slice, int y0, int y1) {
+        step_ahead(board, rule, d, y0, y1, scratch[static_cast<size_t>(slice)]);
+      });
+      board.swap_generation();
+    } else if (pool) {
+      pool->step(board, rule);
+    } else if (opt.threads == 1) {
+      board.step(rule);
+    } else {
+      board.step_parallel(rule);
+    }
+    gen += depth;
+    if (opt.hooks && opt.hooks->due(gen)) {
+      if (!opt.hooks->dispatch(board, gen)) { break; }
+      if (sparse && opt.hooks->stamped()) { changes.reset(board); }
+    }
+    if (opt.checkpoints) { opt.checkpoints->maybe_save(board, rule, gen); }
+    if (ring.is_open()) {
+      Uint64 now = SDL_GetPerformanceCounter();
+      if (now >= next_publish) {
+        ring.publish(board, gen);
+        next_publish = now + interval;
+      }
+    }
+  }
+  if (ring.is_open()) { ring.publish(board, gen); }
+  if (opt.checkpoints) {
+    opt.checkpoints->flush();
+    opt.checkpoints->save(board, rule, gen);
+    opt.checkpoints->flush();
+  }
+
+  const double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / frequency;
+  SDL_Log("headless: %dx%d, generation %llu, population %llu, hash %016llx, %.3f s (%.1f gen/s)",
+          board.get_w(), board.get_h(),
+          static_cast<unsigned long long>(gen),
+          static_cast<unsigned long long>(board.population()),
+          static_cast<unsigned long long>(board.hash()), seconds,
+          seconds > 0 ? static_cast<double>(gen - first_gen) / seconds : 0.0);
+  return 0;
+}
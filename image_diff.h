@@ -0,0 +1,57 @@
+#pragma once
+// Pixel comparison for golden-image checks of the offscreen render path.
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <cstdlib>
+
+struct ImageDiff {
+  int      width {0};
+  int      height {0};
+  uint64_t differing {0};  // pixels with any channel off by more than the tolerance
+  int      max_delta {0};  // largest channel difference seen
+};
+
+// Compares two surfaces channel by channel in RGBA32. If diff_out is given it
+// receives a copy of `actual` with the differing pixels painted red. Returns
+// false if the surfaces cannot be compared (different sizes, conversion failure).
+inline bool diff_images(SDL_Surface *actual, SDL_Surface *expected, int tolerance, ImageDiff &out,
+                        SDL_Surface **diff_out = nullptr) {
+  if (!actual || !expected || actual->w != expected->w || actual->h != expected->h) { return false; }
+  SDL_Surface *a = SDL_ConvertSurface(actual, SDL_PIXELFORMAT_RGBA32);
+  SDL_Surface *b = SDL_ConvertSurface(expected, SDL_PIXELFORMAT_RGBA32);
+  if (!a || !b) {
+    SDL_DestroySurface(a);
+    SDL_DestroySurface(b);
+    return false;
+  }
+  SDL_LockSurface(a);
+  SDL_LockSurface(b);
+
+  out = ImageDiff {a->w, a->h, 0, 0};
+  for (int y = 0; y < a->h; ++y) {
+    uint8_t *pa = static_cast<uint8_t *>(a->pixels) + static_cast<size_t>(y) * a->pitch;
+    const uint8_t *pb = static_cast<const uint8_t *>(b->pixels) + static_cast<size_t>(y) * b->pitch;
+    for (int x = 0; x < a->w; ++x, pa += 4, pb += 4) {
+      int worst {0};
+      for (int c = 0; c < 4; ++c) {
+        const int d = std::abs(static_cast<int>(pa[c]) - static_cast<int>(pb[c]));
+        worst = d > worst ? d : worst;
+      }
+      out.max_delta = worst > out.max_delta ? worst : out.max_delta;
+      if (worst > tolerance) {
+        ++out.differing;
+        if (diff_out) { pa[0] = 255; pa[1] = 0; pa[2] = 0; pa[3] = 255; }
+      }
+    }
+  }
+
+  SDL_UnlockSurface(b);
+  SDL_UnlockSurface(a);
+  SDL_DestroySurface(b);
+  if (diff_out) {
+    *diff_out = a;
+  } else {
+    SDL_DestroySurface(a);
+  }
+  return true;
+}
@@ -0,0 +1,65 @@
+#pragma once
+// Input gathered by SDL_AppEvent and handed to the window once per frame.
+//
+// push() only records the event, so a burst of input costs SDL_AppEvent
+// next to nothing and can't hold up SDL_AppIterate. Pointer motion is
+// coalesced to the latest position; clicks and key presses are kept in
+// arrival order, since later ones may depend on earlier ones (click a cell,
+// then Enter to start). SDL may deliver events pushed from other threads
+// while SDL_AppIterate runs, hence the lock.
+#include <SDL3/SDL.h>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+struct InputBatch {
+  std::vector<SDL_Event> events;  // button and key presses, oldest first
+  bool       moved {false};       // pointer moved since the last batch
+  SDL_FPoint pointer {0.0f, 0.0f};// latest pointer position, window coordinates
+  size_t     coalesced {0};       // motion events folded into `pointer`
+  bool       woke {false};        // some other event came in (resize, expose, a wakeup)
+
+  void clear() {
+    events.clear();
+    moved = false;
+    coalesced = 0;
+    woke = false;
+  }
+};
+
+class InputQueue {
+public:
+  void push(const SDL_Event &e) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    switch (e.type) {
+      case SDL_EVENT_MOUSE_MOTION:
+        pending_.pointer = {e.motion.x, e.motion.y};
+        pending_.moved = true;
+        ++pending_.coalesced;
+        break;
+      case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        pending_.pointer = {e.button.x, e.button.y};
+        pending_.moved = true;
+        pending_.events.push_back(e);
+        break;
+      case SDL_EVENT_KEY_DOWN:
+        pending_.events.push_back(e);
+        break;
+      default:
+        pending_.woke = true;
+        break;
+    }
+  }
+
+  // Swaps everything queued since the last call into out. Reusing the same
+  // batch every frame keeps its vector's storage.
+  void take(InputBatch &out) {
+    out.clear();
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::swap(out, pending_);
+  }
+
+private:
+  std::mutex mutex_;
+  InputBatch pending_;
+};
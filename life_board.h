@@ -0,0 +1,247 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include <utility>
+#include "cpu_kernels.h"
+#include "parallel.h"
+
+// Outer-totalistic rule. Bit n of birth/survive is set when a cell with n live
+// neighbors is born/survives. Defaults to Conway's B3/S23.
+struct Rule {
+  uint16_t birth   {1u << 3};
+  uint16_t survive {(1u << 2) | (1u << 3)};
+
+  bool next(bool alive, int neighbors) const {
+    return ((alive ? survive : birth) >> neighbors) & 1u;
+  }
+
+  bool operator==(const Rule &o) const { return birth == o.birth && survive == o.survive; }
+};
+
+// Parses "B3/S23" style notation (case-insensitive, either order).
+inline bool parse_rule(const char *text, Rule &rule) {
+  Rule r {0, 0};
+  uint16_t *digits {nullptr};
+  bool seen_b {false}, seen_s {false};
+  for (const char *p = text; *p; ++p) {
+    char c = *p;
+    if (c == 'B' || c == 'b') { digits = &r.birth;   seen_b = true; }
+    else if (c == 'S' || c == 's') { digits = &r.survive; seen_s = true; }
+    else if (c >= '0' && c <= '8' && digits) { *digits = static_cast<uint16_t>(*digits | (1u << (c - '0'))); }
+    else if (c != '/') { return false; }
+  }
+  if (!seen_b || !seen_s) { return false; }
+  rule = r;
+  return true;
+}
+
+// Formats a rule as "B3/S23". buf needs room for 22 bytes.
+inline void format_rule(const Rule &rule, char *buf) {
+  *buf++ = 'B';
+  for (int n = 0; n <= 8; ++n) { if (rule.birth >> n & 1u) { *buf++ = static_cast<char>('0' + n); } }
+  *buf++ = '/';
+  *buf++ = 'S';
+  for (int n = 0; n <= 8; ++n) { if (rule.survive >> n & 1u) { *buf++ = static_cast<char>('0' + n); } }
+  *buf = '\0';
+}
+
+// Live neighbors of (x, y) on a w x h grid with a dead boundary, reading one
+// cell at a time through alive(x, y). This is the plain definition the packed
+// stepper is checked against, and what the per-cell window stepper uses.
+template <class Alive>
+inline int live_neighbors(const Alive &alive, int x, int y, int w, int h) {
+  int n {0};
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      const int nx = x + dx, ny = y + dy;
+      if ((dx || dy) && nx >= 0 && ny >= 0 && nx < w && ny < h && alive(nx, ny)) { ++n; }
+    }
+  }
+  return n;
+}
+
+// Advances one packed row. above/below may be nullptr for dead rows outside the
+// board. Bit x of word k is column 64*k + x; bits past the board width are kept 0.
+// Runs on the kernel tier picked by cpu_kernels().
+inline void step_row(const uint64_t *above, const uint64_t *center, const uint64_t *below,
+                     uint64_t *out, int stride, uint64_t tail_mask, const Rule &rule) {
+  cpu_kernels().step_row(above, center, below, out, stride, tail_mask, rule.birth, rule.survive);
+}
+
+// Allocator that leaves new elements uninitialized, so the pages of a fresh
+// buffer are first touched, and on NUMA machines placed, by whichever thread
+// writes them first rather than by the one that allocated them.
+template <class T>
+struct UninitAllocator : std::allocator<T> {
+  template <class U> struct rebind { using other = UninitAllocator<U>; };
+  UninitAllocator() = default;
+  template <class U> UninitAllocator(const UninitAllocator<U> &) {}
+  template <class U> void construct(U *p) { ::new (static_cast<void *>(p)) U; }
+  template <class U, class... Args> void construct(U *p, Args &&...args) {
+    ::new (static_cast<void *>(p)) U(std::forward<Args>(args)...);
+  }
+};
+
+using BoardBits = std::vector<uint64_t, UninitAllocator<uint64_t>>;
+
+// Immutable view of one generation that shares storage with the board it
+// came from. Cheap to take; see LifeBoard::snapshot().
+struct BoardSnapshot {
+  std::shared_ptr<const BoardBits> bits;
+  int width {0};
+  int height {0};
+  int stride {0};
+
+  const uint64_t *row(int y) const { return bits->data() + static_cast<size_t>(y) * stride; }
+};
+
+// Bit-packed board with a dead boundary, one bit per cell, rows padded to 64 bits.
+//
+// The current generation is copy-on-write: copies and snapshots share it, and
+// the first mutable access of a shared board clones it. The back buffer that
+// step_rows() fills is never shared, so bands may be stepped concurrently.
+class LifeBoard {
+public:
+  LifeBoard() : bits_{std::make_shared<Buffer>()}, next_{std::make_shared<Buffer>()} {}
+  LifeBoard(int w, int h)
+    : w_{w}, h_{h}, stride_{(w + 63) / 64},
+      bits_{std::make_shared<Buffer>(static_cast<size_t>(stride_) * h, 0)},
+      next_{std::make_shared<Buffer>(bits_->size(), 0)} {}
+  // A board whose storage is allocated but not written yet. Every row has to
+  // go through clear_rows() before the board is used, normally from the
+  // thread that will step it (see BandPool).
+  struct Untouched {};
+  LifeBoard(int w, int h, Untouched)
+    : w_{w}, h_{h}, stride_{(w + 63) / 64},
+      bits_{std::make_shared<Buffer>(static_cast<size_t>(stride_) * h)},
+      next_{std::make_shared<Buffer>(bits_->size())} {}
+  LifeBoard(const LifeBoard &o)
+    : w_{o.w_}, h_{o.h_}, stride_{o.stride_}, bits_{o.bits_},
+      next_{std::make_shared<Buffer>(o.bits_->size(), 0)} {}
+  LifeBoard(LifeBoard &&) = default;
+  LifeBoard &operator=(const LifeBoard &o) {
+    if (this != &o) { *this = LifeBoard(o); }
+    return *this;
+  }
+  LifeBoard &operator=(LifeBoard &&) = default;
+
+  int get_w()      const { return w_; }
+  int get_h()      const { return h_; }
+  int get_stride() const { return stride_; }
+  uint64_t tail_mask() const { return w_ % 64 ? (1ull << (w_ % 64)) - 1 : ~0ull; }
+
+  uint64_t       *row(int y)       { own_(); return bits_->data() + static_cast<size_t>(y) * stride_; }
+  const uint64_t *row(int y) const { return bits_->data() + static_cast<size_t>(y) * stride_; }
+
+  bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1u; }
+  void set(int x, int y, bool alive) {
+    uint64_t bit = 1ull << (x & 63);
+    if (alive) { row(y)[x >> 6] |= bit; } else { row(y)[x >> 6] &= ~bit; }
+  }
+  // Sets n live cells starting at (x, y), a word at a time.
+  void set_span(int x, int y, int n) {
+    uint64_t *r = row(y);
+    for (int end = x + n; x < end;) {
+      const int bit = x & 63;
+      const int take = std::min(64 - bit, end - x);
+      r[x >> 6] |= (take == 64 ? ~0ull : ((1ull << take) - 1)) << bit;
+      x += take;
+    }
+  }
+  void clear() {
+    own_();
+    std::fill(bits_->begin(), bits_->end(), 0);
+  }
+  // Zeroes rows [y0, y1) of both the current and the back buffer.
+  void clear_rows(int y0, int y1) {
+    own_();
+    const size_t lo = static_cast<size_t>(y0) * stride_, hi = static_cast<size_t>(y1) * stride_;
+    std::fill(bits_->begin() + lo, bits_->begin() + hi, 0);
+    std::fill(next_->begin() + lo, next_->begin() + hi, 0);
+  }
+
+  // Fills the board with a soup that depends only on (seed, absolute cell
+  // position), so any band of a larger board can be generated on its own.
+  void fill_random(uint64_t seed, int percent, int y_offset = 0) {
+    for (int y = 0; y < h_; ++y) {
+      uint64_t *r = row(y);
+      for (int x = 0; x < w_; ++x) {
+        uint64_t v = mix64(seed ^ mix64((static_cast<uint64_t>(y + y_offset) << 32) | static_cast<uint32_t>(x)));
+        if (static_cast<int>(v % 100) < percent) { r[x >> 6] |= 1ull << (x & 63); }
+      }
+    }
+  }
+
+  uint64_t population() const {
+    return parallel_sum<uint64_t>(0, h_, parallel_grain(), [this](int y0, int y1) {
+      return cpu_kernels().popcount(row(y0), static_cast<size_t>(y1 - y0) * stride_);
+    });
+  }
+
+  uint64_t hash(int y_offset = 0) const {
+    return parallel_sum<uint64_t>(0, h_, parallel_grain(), [this, y_offset](int y0, int y1) {
+      return cpu_kernels().hash_rows(bits_->data(), stride_, y0, y1, y_offset);
+    });
+  }
+
+  // Rows per parallel slice worth the hand-off (about 128 KiB of cells).
+  int parallel_grain() const { return std::max(1, 16384 / std::max(stride_, 1)); }
+
+  // Shares the current generation without copying it. Stepping afterwards
+  // leaves the snapshot untouched.
+  BoardSnapshot snapshot() const { return {bits_, w_, h_, stride_}; }
+
+  // Computes rows [y0, y1) of the next generation into the back buffer.
+  // north/south stand in for the rows just outside the board (nullptr = dead).
+  void step_rows(const Rule &rule, int y0, int y1,
+                 const uint64_t *north = nullptr, const uint64_t *south = nullptr) {
+    const LifeBoard &cur = *this;
+    const auto step = cpu_kernels().step_row;
+    for (int y = y0; y < y1; ++y) {
+      const uint64_t *above = y > 0      ? cur.row(y - 1) : north;
+      const uint64_t *below = y + 1 < h_ ? cur.row(y + 1) : south;
+      step(above, cur.row(y), below, next_->data() + static_cast<size_t>(y) * stride_, stride_, tail_mask(),
+           rule.birth, rule.survive);
+    }
+  }
+
+  // Row y of the back buffer, for steppers that fill it themselves. Like
+  // step_rows(), bands of it may be written concurrently.
+  uint64_t *back_row(int y) { return next_->data() + static_cast<size_t>(y) * stride_; }
+
+  // Makes the back buffer filled by step_rows() the current generation. If a
+  // snapshot still holds the outgoing generation, a fresh back buffer is
+  // allocated rather than overwriting it; it is left unwritten, since the
+  // next step rewrites every row, so its pages land with the stepping threads.
+  void swap_generation() {
+    std::swap(bits_, next_);
+    if (next_.use_count() > 1) { next_ = std::make_shared<Buffer>(bits_->size()); }
+  }
+
+  void step(const Rule &rule) {
+    step_rows(rule, 0, h_);
+    swap_generation();
+  }
+
+  // step() with the rows split over the parallel_for() backend.
+  void step_parallel(const Rule &rule) {
+    parallel_for(0, h_, parallel_grain(), [this, &rule](int y0, int y1) { step_rows(rule, y0, y1); });
+    swap_generation();
+  }
+
+private:
+  using Buffer = BoardBits;
+
+  int w_ {0};
+  int h_ {0};
+  int stride_ {0};
+  std::shared_ptr<Buffer> bits_;
+  std::shared_ptr<Buffer> next_;
+
+  void own_() {
+    if (bits_.use_count() > 1) { bits_ = std::make_shared<Buffer>(*bits_); }
+  }
+};
@@ -0,0 +1,217 @@
+#pragma once
+// Fork-join helpers for splitting row ranges across cores.
+//
+// The backend is picked at build time (AUTO_CELL_PARALLEL in CMakeLists.txt)
+// by defining one of:
+//   AUTO_CELL_PARALLEL_SERIAL   everything on the calling thread
+//   AUTO_CELL_PARALLEL_THREADS  std::threads started per call
+//   AUTO_CELL_PARALLEL_POOL     persistent workers, started on first use (the
+//                               default: stepping, census and hashing call in
+//                               every generation, and spawning threads each
+//                               time costs more than it saves on mid-sized boards)
+//   AUTO_CELL_PARALLEL_OPENMP   #pragma omp parallel for
+//   AUTO_CELL_PARALLEL_STDPAR   std::for_each(std::execution::par, ...)
+// Every backend cuts the range into the same contiguous slices, so callers
+// see identical results and only the scheduling differs.
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if !defined(AUTO_CELL_PARALLEL_SERIAL) && !defined(AUTO_CELL_PARALLEL_THREADS) && \
+    !defined(AUTO_CELL_PARALLEL_OPENMP) && !defined(AUTO_CELL_PARALLEL_STDPAR)
+#define AUTO_CELL_PARALLEL_POOL 1
+#endif
+#if defined(AUTO_CELL_PARALLEL_OPENMP)
+#include <omp.h>
+#elif defined(AUTO_CELL_PARALLEL_STDPAR)
+#include <execution>
+#include <numeric>
+#endif
+
+inline int worker_count() {
+#if defined(AUTO_CELL_PARALLEL_SERIAL)
+  return 1;
+#else
+  unsigned n = std::thread::hardware_concurrency();
+  return n > 0 ? static_cast<int>(n) : 1;
+#endif
+}
+
+inline const char *parallel_backend() {
+#if defined(AUTO_CELL_PARALLEL_SERIAL)
+  return "serial";
+#elif defined(AUTO_CELL_PARALLEL_THREADS)
+  return "threads";
+#elif defined(AUTO_CELL_PARALLEL_OPENMP)
+  return "openmp";
+#elif defined(AUTO_CELL_PARALLEL_STDPAR)
+  return "stdpar";
+#else
+  return "pool";
+#endif
+}
+
+namespace parallel_detail {
+
+#if defined(AUTO_CELL_PARALLEL_POOL)
+// Workers that sleep between calls. The caller works too, and slices are
+// handed out through an atomic counter. A parallel_for issued from inside a
+// slice runs inline instead of waiting on workers that are all busy.
+class Pool {
+public:
+  static Pool &instance() {
+    static Pool pool;
+    return pool;
+  }
+
+  void run(int parts, const std::function<void(int)> &slice) {
+    if (in_slice_() || threads_.empty()) {
+      for (int p = 0; p < parts; ++p) { slice(p); }
+      return;
+    }
+    std::lock_guard<std::mutex> serialize(run_mutex_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      slice_ = &slice;
+      parts_ = parts;
+      next_.store(0);
+      active_ = static_cast<int>(threads_.size());
+      ++round_;
+    }
+    wake_.notify_all();
+    work_();
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return active_ == 0; });
+    slice_ = nullptr;
+  }
+
+  ~Pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread &t : threads_) { t.join(); }
+  }
+
+private:
+  std::vector<std::thread> threads_;
+  std::mutex run_mutex_;  // one parallel_for at a time from outside the pool
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int)> *slice_ {nullptr};
+  int parts_ {0};
+  std::atomic<int> next_ {0};
+  int active_ {0};
+  uint64_t round_ {0};
+  bool stop_ {false};
+
+  Pool() {
+    const int n = worker_count() - 1;
+    for (int i = 0; i < n; ++i) { threads_.emplace_back([this] { loop_(); }); }
+  }
+
+  static bool &in_slice_() {
+    thread_local bool inside {false};
+    return inside;
+  }
+
+  void work_() {
+    in_slice_() = true;
+    for (int p = next_.fetch_add(1); p < parts_; p = next_.fetch_add(1)) { (*slice_)(p); }
+    in_slice_() = false;
+  }
+
+  void loop_() {
+    uint64_t seen {0};
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [&] { return stop_ || round_ != seen; });
+      if (stop_) { return; }
+      seen = round_;
+      lock.unlock();
+      work_();
+      lock.lock();
+      if (--active_ == 0) { done_.notify_one(); }
+    }
+  }
+};
+#endif
+
+// Runs slice(p) for every p in [0, parts) on the configured backend.
+template <class Slice>
+void run_slices(int parts, Slice &&slice) {
+#if defined(AUTO_CELL_PARALLEL_SERIAL)
+  for (int p = 0; p < parts; ++p) { slice(p); }
+#elif defined(AUTO_CELL_PARALLEL_POOL)
+  Pool::instance().run(parts, std::function<void(int)>(std::ref(slice)));
+#elif defined(AUTO_CELL_PARALLEL_OPENMP)
+#pragma omp parallel for schedule(static)
+  for (int p = 0; p < parts; ++p) { slice(p); }
+#elif defined(AUTO_CELL_PARALLEL_STDPAR)
+  std::vector<int> index(static_cast<size_t>(parts));
+  std::iota(index.begin(), index.end(), 0);
+  std::for_each(std::execution::par, index.begin(), index.end(), [&slice](int p) { slice(p); });
+#else
+  std::vector<std::thread> threads;
+  threads.reserve(static_cast<size_t>(parts - 1));
+  for (int p = 1; p < parts; ++p) { threads.emplace_back([&slice, p] { slice(p); }); }
+  slice(0);
+  for (std::thread &t : threads) { t.join(); }
+#endif
+}
+
+// Number of slices for n items: one per worker, each at least `grain` long.
+inline int slice_count(int n, int grain) {
+  return std::max(1, std::min(worker_count(), n / std::max(grain, 1)));
+}
+
+inline int slice_edge(int begin, int n, int parts, int p) {
+  return begin + static_cast<int>(static_cast<long long>(n) * p / parts);
+}
+
+}  // namespace parallel_detail
+
+// Calls fn(slice, lo, hi) on contiguous slices covering [begin, end), one per
+// worker, and returns when all are done. Slices are at least `grain` long, so
+// small ranges run inline on the calling thread. slice is below
+// worker_count(), for indexing scratch that outlives the call.
+template <class Fn>
+void parallel_for_slices(int begin, int end, int grain, Fn &&fn) {
+  using namespace parallel_detail;
+  const int n = end - begin;
+  if (n <= 0) { return; }
+  const int parts = slice_count(n, grain);
+  if (parts == 1) { fn(0, begin, end); return; }
+  run_slices(parts, [&](int p) { fn(p, slice_edge(begin, n, parts, p), slice_edge(begin, n, parts, p + 1)); });
+}
+
+// parallel_for_slices() for callers that don't need the slice number.
+template <class Fn>
+void parallel_for(int begin, int end, int grain, Fn &&fn) {
+  parallel_for_slices(begin, end, grain, [&fn](int, int lo, int hi) { fn(lo, hi); });
+}
+
+// Sums fn(lo, hi) over the same slices parallel_for() would use. The partial
+// results are added in slice order, so the total doesn't depend on timing.
+template <class T, class Fn>
+T parallel_sum(int begin, int end, int grain, Fn &&fn) {
+  using namespace parallel_detail;
+  const int n = end - begin;
+  if (n <= 0) { return T {}; }
+  const int parts = slice_count(n, grain);
+  if (parts == 1) { return fn(begin, end); }
+  std::vector<T> partial(static_cast<size_t>(parts));
+  run_slices(parts, [&](int p) {
+    partial[static_cast<size_t>(p)] = fn(slice_edge(begin, n, parts, p), slice_edge(begin, n, parts, p + 1));
+  });
+  T total {};
+  for (const T &t : partial) { total += t; }
+  return total;
+}
@@ -0,0 +1,166 @@
+#pragma once
+// Pattern files. Only RLE for now: https://conwaylife.com/wiki/Run_Length_Encoded
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include "life_board.h"
+
+// Bounds for untrusted pattern files. Parsing is linear in the input and
+// never allocates more than max_cells bits, whatever the header claims.
+struct PatternLimits {
+  int     max_width  {65536};
+  int     max_height {65536};
+  int64_t max_cells  {int64_t {1} << 28};  // 32 MiB of packed board
+};
+
+namespace pattern_detail {
+
+inline bool is_space(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// Walks an RLE body and calls put(x, y, run) for every run of live cells.
+// Returns false on a malformed body or one that leaves limits.
+template <typename Put>
+bool walk_rle_body(const char *p, const char *end, const PatternLimits &limits,
+                   int &width, int &height, std::string *error, Put put) {
+  int x {0}, y {0};
+  int64_t run {0};
+  width = 0;
+  height = 0;
+  auto fail = [&](const char *msg) { if (error) { *error = msg; } return false; };
+
+  for (; p < end; ++p) {
+    char c = *p;
+    if (is_space(c)) { continue; }
+    if (c >= '0' && c <= '9') {
+      run = run * 10 + (c - '0');
+      if (run > limits.max_width && run > limits.max_height) { return fail("run count too large"); }
+      continue;
+    }
+    int n = run > 0 ? static_cast<int>(run) : 1;
+    run = 0;
+    if (c == '!') { break; }
+    if (c == '$') {
+      y += n;
+      x = 0;
+      if (y >= limits.max_height) { return fail("pattern too tall"); }
+      continue;
+    }
+    if (c == 'b' || c == '.') {
+      x += n;
+    } else if (c == 'o' || (c >= 'A' && c <= 'Z')) {
+      if (x + n > limits.max_width) { return fail("pattern too wide"); }
+      put(x, y, n);
+      x += n;
+    } else {
+      return fail("unexpected character in RLE body");
+    }
+    if (x > limits.max_width) { return fail("pattern too wide"); }
+    if (c != 'b' && c != '.') {
+      width  = x > width ? x : width;
+      height = y + 1 > height ? y + 1 : height;
+    }
+  }
+  return true;
+}
+
+} // namespace pattern_detail
+
+// Parses an RLE pattern into a board sized to fit it. The "x = .., y = ..,
+// rule = .." header and '#' comment lines are optional, so a bare body such
+// as "bo$2bo$3o!" is accepted too. rule is only written when the header names one.
+inline bool parse_rle(const char *data, size_t size, LifeBoard &out, Rule *rule = nullptr,
+                      std::string *error = nullptr, const PatternLimits &limits = {}) {
+  using namespace pattern_detail;
+  const char *p = data;
+  const char *end = data + size;
+  int header_w {0}, header_h {0};
+
+  // comment and header lines
+  for (;;) {
+    while (p < end && is_space(*p)) { ++p; }
+    if (p == end || (*p != '#' && *p != 'x')) { break; }
+    const char *eol = p;
+    while (eol < end && *eol != '\n') { ++eol; }
+    if (*p == 'x') {
+      std::string line(p, eol);
+      char rule_text[64] {};
+      if (SDL_sscanf(line.c_str(), "x = %d , y = %d , rule = %63s", &header_w, &header_h, rule_text) < 2) {
+        if (error) { *error = "bad RLE header"; }
+        return false;
+      }
+      if (header_w < 0 || header_h < 0 || header_w > limits.max_width || header_h > limits.max_height) {
+        if (error) { *error = "pattern exceeds size limits"; }
+        return false;
+      }
+      if (rule_text[0] && rule) {
+        Rule r;
+        if (!parse_rule(rule_text, r)) {
+          if (error) { *error = "unsupported rule"; }
+          return false;
+        }
+        *rule = r;
+      }
+    }
+    p = eol;
+  }
+
+  int w {0}, h {0};
+  if (!walk_rle_body(p, end, limits, w, h, error, [](int, int, int) {})) { return false; }
+  w = w > header_w ? w : header_w;
+  h = h > header_h ? h : header_h;
+  if (static_cast<int64_t>(w) * h > limits.max_cells) {
+    if (error) { *error = "pattern exceeds size limits"; }
+    return false;
+  }
+
+  LifeBoard board(w > 0 ? w : 1, h > 0 ? h : 1);
+  walk_rle_body(p, end, limits, w, h, nullptr, [&](int x, int y, int n) { board.set_span(x, y, n); });
+  out = std::move(board);
+  return true;
+}
+
+// RLE body (no header) for a board, wrapped at line_width columns (0 = one line).
+inline std::string rle_body(const LifeBoard &board, int line_width = 70) {
+  std::string out;
+  int column {0};
+  auto emit = [&](int n, char tag) {
+    char buf[16];
+    int len = n > 1 ? SDL_snprintf(buf, sizeof(buf), "%d%c", n, tag) : SDL_snprintf(buf, sizeof(buf), "%c", tag);
+    if (line_width > 0 && column + len > line_width) {
+      out += '\n';
+      column = 0;
+    }
+    out.append(buf, static_cast<size_t>(len));
+    column += len;
+  };
+
+  int blank_rows {0};
+  for (int y = 0; y < board.get_h(); ++y) {
+    int x {0};
+    bool row_started {false};
+    while (x < board.get_w()) {
+      bool alive = board.get(x, y);
+      int n {1};
+      while (x + n < board.get_w() && board.get(x + n, y) == alive) { ++n; }
+      if (alive || x + n < board.get_w()) {  // trailing dead cells are implied
+        if (!row_started && y > 0) { emit(blank_rows + 1, '$'); blank_rows = 0; }
+        row_started = true;
+        emit(n, alive ? 'o' : 'b');
+      }
+      x += n;
+    }
+    if (!row_started && y > 0) { ++blank_rows; }
+  }
+  emit(1, '!');
+  return out;
+}
+
+// Full RLE file contents with header.
+inline std::string write_rle(const LifeBoard &board, const Rule &rule) {
+  char rule_text[24];
+  format_rule(rule, rule_text);
+  char header[96];
+  SDL_snprintf(header, sizeof(header), "x = %d, y = %d, rule = %s\n", board.get_w(), board.get_h(), rule_text);
+  return header + rle_body(board) + "\n";
+}
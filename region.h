@@ -0,0 +1,130 @@
+#pragma once
+// Region-of-interest runs: a rectangle of a board copied out and stepped on
+// its own, for trying out one component of a large construction without
+// paying for the whole board every generation.
+//
+// The region gets its own edge: dead (cells outside count as dead, like the
+// board's own boundary) or torus (opposite edges are neighbours). Nothing
+// outside the rectangle is read once the copy is taken, and the source board
+// is only changed by commit(), which writes the region back in place.
+//
+// A torus region is kept one column wider on each side; before every step
+// those columns are refilled from the opposite edge, and the rows above and
+// below come from step_rows()'s north/south arguments, so the packed kernels
+// do all the stepping.
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "life_board.h"
+#include "parallel.h"
+
+enum class RegionEdge { kDead, kTorus };
+
+inline const char *region_edge_name(RegionEdge e) { return e == RegionEdge::kTorus ? "torus" : "dead"; }
+
+inline bool parse_region_edge(const char *text, RegionEdge &out) {
+  if (std::strcmp(text, "dead") == 0)  { out = RegionEdge::kDead;  return true; }
+  if (std::strcmp(text, "torus") == 0) { out = RegionEdge::kTorus; return true; }
+  return false;
+}
+
+namespace region_detail {
+
+// n <= 64 bits of a packed row starting at bit pos, low bit first.
+inline uint64_t read_bits(const uint64_t *row, int stride, int pos, int n) {
+  const int word = pos >> 6, shift = pos & 63;
+  uint64_t v = row[word] >> shift;
+  if (shift && word + 1 < stride) { v |= row[word + 1] << (64 - shift); }
+  return n == 64 ? v : v & ((1ull << n) - 1);
+}
+
+// Overwrites n <= 64 bits of a packed row starting at bit pos.
+inline void write_bits(uint64_t *row, int pos, uint64_t v, int n) {
+  const int word = pos >> 6, shift = pos & 63;
+  const uint64_t mask = n == 64 ? ~0ull : (1ull << n) - 1;
+  v &= mask;
+  row[word] = (row[word] & ~(mask << shift)) | (v << shift);
+  if (shift && shift + n > 64) {
+    row[word + 1] = (row[word + 1] & ~(mask >> (64 - shift))) | (v >> (64 - shift));
+  }
+}
+
+}  // namespace region_detail
+
+// Copies the w x h cells at (x, y) of src over the ones at (dx, dy) of dst,
+// 64 cells at a time. Both rectangles must lie inside their boards.
+inline void copy_cells(const LifeBoard &src, int x, int y, int w, int h, LifeBoard &dst, int dx, int dy) {
+  using namespace region_detail;
+  for (int r = 0; r < h; ++r) {
+    const uint64_t *from = src.row(y + r);
+    uint64_t *to = dst.row(dy + r);
+    for (int c = 0; c < w; c += 64) {
+      const int n = std::min(64, w - c);
+      write_bits(to, dx + c, read_bits(from, src.get_stride(), x + c, n), n);
+    }
+  }
+}
+
+class RegionRun {
+public:
+  // Copies the w x h rectangle at (x, y) of board, clipped to the board.
+  RegionRun(const LifeBoard &board, int x, int y, int w, int h, RegionEdge edge)
+    : x_{std::clamp(x, 0, board.get_w())}, y_{std::clamp(y, 0, board.get_h())},
+      w_{std::clamp(w, 0, board.get_w() - x_)}, h_{std::clamp(h, 0, board.get_h() - y_)}, edge_{edge},
+      work_{w_ + pad_() * 2, h_} {
+    copy_cells(board, x_, y_, w_, h_, work_, pad_(), 0);
+  }
+
+  int x() const { return x_; }
+  int y() const { return y_; }
+  int w() const { return w_; }
+  int h() const { return h_; }
+  RegionEdge edge() const { return edge_; }
+  uint64_t generation() const { return generation_; }
+
+  void step(const Rule &rule, uint64_t generations = 1) {
+    if (w_ == 0 || h_ == 0) { generation_ += generations; return; }
+    for (uint64_t g = 0; g < generations; ++g) {
+      if (edge_ == RegionEdge::kDead) {
+        work_.step_parallel(rule);
+      } else {
+        wrap_columns_();
+        const LifeBoard &cur = work_;
+        const uint64_t *last = cur.row(h_ - 1), *first = cur.row(0);
+        parallel_for(0, h_, work_.parallel_grain(), [this, &rule, last, first](int y0, int y1) {
+          work_.step_rows(rule, y0, y1, last, first);
+        });
+        work_.swap_generation();
+      }
+    }
+    generation_ += generations;
+  }
+
+  // The region's cells as a w x h board.
+  LifeBoard cells() const {
+    LifeBoard out(w_, h_);
+    copy_cells(work_, pad_(), 0, w_, h_, out, 0, 0);
+    return out;
+  }
+
+  uint64_t population() const { return pad_() ? cells().population() : work_.population(); }
+
+  // Writes the region back over the rectangle it was taken from.
+  void commit(LifeBoard &board) const { copy_cells(work_, pad_(), 0, w_, h_, board, x_, y_); }
+
+private:
+  int x_, y_, w_, h_;
+  RegionEdge edge_;
+  LifeBoard work_;
+  uint64_t generation_ {0};
+
+  int pad_() const { return edge_ == RegionEdge::kTorus ? 1 : 0; }
+
+  // Column 0 mirrors the region's last column and column w + 1 its first.
+  void wrap_columns_() {
+    for (int y = 0; y < h_; ++y) {
+      work_.set(0, y, work_.get(w_, y));
+      work_.set(w_ + 1, y, work_.get(1, y));
+    }
+  }
+};
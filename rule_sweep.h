@@ -0,0 +1,310 @@
+#pragma once
+// Rule-space sweep, run with --sweep FILE: every outer-totalistic rule that
+// passes the filter (all 2^18 of them by default) is run on the same few
+// seeded soups, each soup's fate is classified, and one row per rule goes to
+// a columnar file.
+//
+// Rules and soups are spread over bit-sliced batches, one lane per (rule,
+// soup) pair, so a batch mixes rules freely and refills lanes as they finish.
+// A soup is a fill_random(seed + i) square half the board's side, centered,
+// so it has room to grow before it meets the dead boundary. Half way to the
+// generation limit each lane marks its board (see BatchLife::mark()), and a
+// board that comes back to the marked one has a cycle of exactly that
+// length; population is the other thing the classification looks at:
+//   dies         settled on an empty board
+//   stable       settled into a still life
+//   oscillating  settled into period 2, or came back to its mark
+//   exploding    still moving at the limit, at twice the soup's population
+//   chaotic      still moving at the limit, without growing that much
+// A rule gets the class most of its soups got; ties go to the later class.
+//
+// File layout (native endianness):
+//   SweepHeader, then the columns of SweepResults in declaration order, each
+//   `rows` entries long. Widest columns come first so each one stays aligned
+//   for readers that map the file.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "async_io.h"
+#include "batch_life.h"
+#include "life_board.h"
+#include "parallel.h"
+#include "region.h"
+
+enum class SweepClass : uint8_t { kDies, kStable, kOscillating, kExploding, kChaotic };
+constexpr int kSweepClasses {5};
+
+inline const char *sweep_class_name(SweepClass c) {
+  switch (c) {
+    case SweepClass::kDies:        return "dies";
+    case SweepClass::kStable:      return "stable";
+    case SweepClass::kOscillating: return "oscillating";
+    case SweepClass::kExploding:   return "exploding";
+    default:                       return "chaotic";
+  }
+}
+
+// A rule as an 18-bit number: birth mask in bits 0-8, survive in 9-17.
+inline uint32_t rule_index(const Rule &rule) {
+  return static_cast<uint32_t>(rule.birth & 0x1ffu) | static_cast<uint32_t>(rule.survive & 0x1ffu) << 9;
+}
+inline Rule rule_from_index(uint32_t index) {
+  return Rule {static_cast<uint16_t>(index & 0x1ffu), static_cast<uint16_t>(index >> 9 & 0x1ffu)};
+}
+
+struct SweepOptions {
+  const char *path {nullptr};
+  Rule     require {0, 0};   // swept rules have all of these birth and survive bits
+  Rule     exclude {0, 0};   // and none of these
+  int      size {32};        // board side; soups are half as wide
+  int      soups {4};        // per rule, at most 255
+  uint64_t seed {1};
+  int      density {35};
+  int      generations {256};
+  int      words {8};        // see BatchLife
+};
+
+// Rule indices passing the filter, ascending.
+inline std::vector<uint32_t> sweep_rules(const SweepOptions &opt) {
+  const uint32_t require = rule_index(opt.require), exclude = rule_index(opt.exclude);
+  std::vector<uint32_t> rules;
+  for (uint32_t r = 0; r < (1u << 18); ++r) {
+    if ((r & require) == require && !(r & exclude)) { rules.push_back(r); }
+  }
+  return rules;
+}
+
+struct SweepResults {
+  std::vector<uint32_t> rule;        // rule_index()
+  std::vector<float>    population;  // mean over the soups at their end
+  std::vector<uint16_t> period;      // longest period any soup ended in, 0 if none did
+  std::vector<uint8_t>  behavior;    // SweepClass of the rule
+  std::vector<uint8_t>  count[kSweepClasses];  // soups per SweepClass
+
+  size_t rows() const { return rule.size(); }
+  void resize(size_t n) {
+    rule.resize(n);
+    population.resize(n);
+    period.resize(n);
+    behavior.resize(n);
+    for (auto &c : count) { c.resize(n); }
+  }
+};
+
+struct SweepHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t rows;
+  int32_t  size;
+  int32_t  soups;
+  int32_t  generations;
+  int32_t  density;
+  uint64_t seed;
+  uint64_t checksum;  // over the other header fields and the columns
+};
+
+constexpr uint32_t kSweepMagic   {0x57534341};  // "ACSW"
+constexpr uint32_t kSweepVersion {1};
+
+namespace sweep_detail {
+
+// Every soup as a full board, and its population.
+struct Soups {
+  std::vector<LifeBoard> boards;
+  std::vector<uint32_t>  population;
+};
+
+inline Soups make_soups(const SweepOptions &opt) {
+  Soups s;
+  const int side = std::max(1, opt.size / 2), at = (opt.size - side) / 2;
+  for (int i = 0; i < opt.soups; ++i) {
+    LifeBoard patch(side, side);
+    patch.fill_random(opt.seed + static_cast<uint64_t>(i), opt.density);
+    LifeBoard board(opt.size, opt.size);
+    copy_cells(patch, 0, 0, side, side, board, at, at);
+    s.population.push_back(static_cast<uint32_t>(board.population()));
+    s.boards.push_back(std::move(board));
+  }
+  return s;
+}
+
+// Runs rows [first, last) of out, whose rule column is filled in.
+inline void sweep_range(const SweepOptions &opt, const Soups &soups, int first, int last, SweepResults &out) {
+  BatchLife batch(opt.size, opt.size, opt.words);
+  const size_t lanes = static_cast<size_t>(batch.lanes());
+  std::vector<int64_t> item(lanes, -1);  // row * soups + soup
+  std::vector<float>   pop_sum(static_cast<size_t>(last - first), 0.0f);
+  const uint64_t limit = static_cast<uint64_t>(opt.generations), half = limit / 2;
+
+  const int64_t end = static_cast<int64_t>(last) * opt.soups;
+  int64_t next = static_cast<int64_t>(first) * opt.soups;
+  auto refill = [&](int lane) {
+    if (next < end) {
+      const size_t row = static_cast<size_t>(next / opt.soups);
+      batch.set_rule(lane, rule_from_index(out.rule[row]));
+      batch.load(lane, soups.boards[static_cast<size_t>(next % opt.soups)]);
+      item[static_cast<size_t>(lane)] = next++;
+    } else {
+      batch.clear(lane);
+    }
+  };
+  auto finish = [&](int lane, SweepClass c, uint64_t period) {
+    const size_t row = static_cast<size_t>(item[static_cast<size_t>(lane)] / opt.soups);
+    ++out.count[static_cast<int>(c)][row];
+    out.period[row] = std::max(out.period[row], static_cast<uint16_t>(std::min<uint64_t>(period, 0xffff)));
+    pop_sum[row - static_cast<size_t>(first)] += static_cast<float>(batch.population(lane));
+    refill(lane);
+  };
+  for (int lane = 0; lane < batch.lanes(); ++lane) { refill(lane); }
+
+  while (batch.busy_count() > 0) {
+    batch.step();
+    for (int lane = 0; lane < batch.lanes(); ++lane) {
+      if (!batch.busy(lane)) { continue; }
+      const uint64_t age = batch.age(lane);
+      if (batch.settled(lane)) {
+        if (batch.population(lane) == 0) {
+          finish(lane, SweepClass::kDies, 0);
+        } else {
+          finish(lane, batch.period(lane) == 1 ? SweepClass::kStable : SweepClass::kOscillating, batch.period(lane));
+        }
+      } else if (batch.at_mark(lane)) {
+        finish(lane, SweepClass::kOscillating, age - batch.mark_age(lane));
+      } else if (age >= limit) {
+        const uint64_t initial = soups.population[static_cast<size_t>(item[static_cast<size_t>(lane)] % opt.soups)];
+        const bool grew = batch.population(lane) >= 2 * std::max<uint64_t>(initial, 1);
+        finish(lane, grew ? SweepClass::kExploding : SweepClass::kChaotic, 0);
+      } else if (age == half) {
+        batch.mark(lane);
+      }
+    }
+  }
+
+  for (int r = first; r < last; ++r) {
+    const size_t row = static_cast<size_t>(r);
+    int best {0};
+    for (int c = 1; c < kSweepClasses; ++c) {
+      if (out.count[c][row] >= out.count[best][row]) { best = c; }
+    }
+    out.behavior[row] = static_cast<uint8_t>(best);
+    out.population[row] = pop_sum[row - static_cast<size_t>(first)] / static_cast<float>(opt.soups);
+  }
+}
+
+inline uint64_t checksum(const SweepHeader &hdr, const char *columns, size_t bytes) {
+  uint64_t h {0x6a09e667f3bcc908ull};
+  h = mix64(h ^ hdr.rows);
+  h = mix64(h ^ (static_cast<uint64_t>(static_cast<uint32_t>(hdr.size)) << 32 | static_cast<uint32_t>(hdr.soups)));
+  h = mix64(h ^ (static_cast<uint64_t>(static_cast<uint32_t>(hdr.generations)) << 32 | static_cast<uint32_t>(hdr.density)));
+  h = mix64(h ^ hdr.seed);
+  for (size_t i = 0; i < bytes; i += 8) {
+    uint64_t w {0};
+    std::memcpy(&w, columns + i, std::min<size_t>(8, bytes - i));
+    h = mix64(h ^ w) + i;
+  }
+  return h;
+}
+
+// Calls fn(data, bytes) on each column in file order.
+template <class R, class Fn>
+void for_each_column(R &res, Fn &&fn) {
+  fn(res.rule.data(), res.rule.size() * sizeof(uint32_t));
+  fn(res.population.data(), res.population.size() * sizeof(float));
+  fn(res.period.data(), res.period.size() * sizeof(uint16_t));
+  fn(res.behavior.data(), res.behavior.size());
+  for (auto &c : res.count) { fn(c.data(), c.size()); }
+}
+
+}  // namespace sweep_detail
+
+// Sweeps the rules that pass opt's filter. Workers take contiguous runs of
+// rules, so each writes only its own rows.
+inline SweepResults sweep_rule_space(const SweepOptions &opt) {
+  SweepResults res;
+  res.rule = sweep_rules(opt);
+  res.resize(res.rule.size());
+  const sweep_detail::Soups soups = sweep_detail::make_soups(opt);
+  const int grain = std::max(1, opt.words * 64 / std::max(opt.soups, 1));
+  parallel_for(0, static_cast<int>(res.rows()), grain, [&](int lo, int hi) {
+    sweep_detail::sweep_range(opt, soups, lo, hi, res);
+  });
+  return res;
+}
+
+inline std::vector<char> serialize_sweep(const SweepResults &res, const SweepOptions &opt) {
+  SweepHeader h {kSweepMagic, kSweepVersion, res.rows(), opt.size, opt.soups, opt.generations, opt.density, opt.seed, 0};
+  std::vector<char> out(sizeof(h));
+  sweep_detail::for_each_column(res, [&out](const void *data, size_t bytes) {
+    const char *p = static_cast<const char *>(data);
+    out.insert(out.end(), p, p + bytes);
+  });
+  h.checksum = sweep_detail::checksum(h, out.data() + sizeof(h), out.size() - sizeof(h));
+  std::memcpy(out.data(), &h, sizeof(h));
+  return out;
+}
+
+// Reads a sweep file back; opt gets the size, soups, generations, density
+// and seed it was made with.
+inline bool parse_sweep(const char *data, size_t size, SweepResults &res, SweepOptions &opt, std::string *error = nullptr) {
+  auto fail = [&](const char *msg) { if (error) { *error = msg; } return false; };
+  SweepHeader h;
+  if (size < sizeof(h)) { return fail("truncated header"); }
+  std::memcpy(&h, data, sizeof(h));
+  if (h.magic != kSweepMagic || h.version != kSweepVersion) { return fail("not a sweep file"); }
+  const size_t row_bytes = 2 * sizeof(uint32_t) + sizeof(uint16_t) + 1 + kSweepClasses;
+  if (h.rows > (1u << 18) || (size - sizeof(h)) != h.rows * row_bytes) { return fail("payload size mismatch"); }
+  if (sweep_detail::checksum(h, data + sizeof(h), size - sizeof(h)) != h.checksum) { return fail("checksum mismatch"); }
+
+  SweepResults r;
+  r.resize(static_cast<size_t>(h.rows));
+  const char *p = data + sizeof(h);
+  sweep_detail::for_each_column(r, [&p](void *column, size_t bytes) {
+    std::memcpy(column, p, bytes);
+    p += bytes;
+  });
+  for (size_t i = 0; i < r.rows(); ++i) {
+    if (r.behavior[i] >= kSweepClasses || r.rule[i] >= (1u << 18)) { return fail("bad row"); }
+  }
+  res = std::move(r);
+  opt.size = h.size;
+  opt.soups = h.soups;
+  opt.generations = h.generations;
+  opt.density = h.density;
+  opt.seed = h.seed;
+  return true;
+}
+
+inline int run_sweep(const SweepOptions &opt, AsyncIo &io) {
+  if (opt.size < 2 || opt.soups < 1 || opt.soups > 255 || opt.generations < 1 || opt.words < 1) {
+    SDL_Log("sweep: size must be at least 2, soups 1 to 255, generations at least 1");
+    return 1;
+  }
+  char require[24], exclude[24];
+  format_rule(opt.require, require);
+  format_rule(opt.exclude, exclude);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  const SweepResults res = sweep_rule_space(opt);
+  const double s = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  SDL_Log("sweep: %zu rules with %s and without %s, %d %dx%d soups each, %d generations, %s kernels",
+          res.rows(), require, exclude, opt.soups, opt.size, opt.size, opt.generations, cpu_kernels().name);
+  uint64_t per_class[kSweepClasses] {};
+  for (uint8_t b : res.behavior) { ++per_class[b]; }
+  for (int c = 0; c < kSweepClasses; ++c) {
+    SDL_Log("sweep: %8llu %s", static_cast<unsigned long long>(per_class[c]), sweep_class_name(static_cast<SweepClass>(c)));
+  }
+  SDL_Log("sweep: %.3f s, %.0f rules/s", s, res.rows() / s);
+
+  bool ok {false};
+  io.start();
+  io.write_file(opt.path, serialize_sweep(res, opt), [&ok](IoResult &r) {
+    ok = r.ok;
+    if (!r.ok) { SDL_Log("sweep: writing %s failed: %s", r.path.c_str(), r.error.c_str()); }
+  }, true);
+  io.stop();
+  io.poll_completions();
+  if (ok) { SDL_Log("sweep: wrote %s", opt.path); }
+  return ok ? 0 : 1;
+}
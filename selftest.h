@@ -0,0 +1,814 @@
+#pragma once
+// Differential self-check, run with --selftest. Every engine is driven side by
+// side with a plain per-cell stepper on soups and on known patterns placed in
+// the middle, along the edges and in the corners of boards whose widths
+// straddle the 64-bit word size. Any disagreement is logged with the first
+// differing cell and fails the run. Known patterns also have their periods
+// and displacements checked against the reference itself.
+//
+// Engines defined elsewhere (the window's stepper) are passed in by the caller.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+#include "analyzer.h"
+#include "band_pool.h"
+#include "batch_life.h"
+#include "change_list.h"
+#include "checkpoint.h"
+#include "control_server.h"
+#include "cpu_kernels.h"
+#include "life_board.h"
+#include "pattern_io.h"
+#include "region.h"
+#include "rule_sweep.h"
+#include "shard.h"
+#include "temporal.h"
+
+struct SelftestEngine {
+  const char *name;
+  std::function<bool(const LifeBoard &, const Rule &)> supports;  // nullptr = any board and rule
+  std::function<void(LifeBoard &, const Rule &, int)> run;        // advance n generations
+};
+
+namespace selftest_detail {
+
+inline void reference_step(LifeBoard &board, const Rule &rule) {
+  const int w = board.get_w(), h = board.get_h();
+  LifeBoard next(w, h);
+  auto alive = [&board](int x, int y) { return board.get(x, y); };
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      if (rule.next(board.get(x, y), live_neighbors(alive, x, y, w, h))) { next.set(x, y, true); }
+    }
+  }
+  board = std::move(next);
+}
+
+// reference_step() on a torus: coordinates wrap at every edge.
+inline void reference_torus_step(LifeBoard &board, const Rule &rule) {
+  const int w = board.get_w(), h = board.get_h();
+  LifeBoard next(w, h);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      int n {0};
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          if ((dx || dy) && board.get((x + dx + w) % w, (y + dy + h) % h)) { ++n; }
+        }
+      }
+      if (rule.next(board.get(x, y), n)) { next.set(x, y, true); }
+    }
+  }
+  board = std::move(next);
+}
+
+// Finds the first differing cell; false if the boards are equal.
+inline bool first_difference(const LifeBoard &a, const LifeBoard &b, int &x, int &y) {
+  if (a.get_w() != b.get_w() || a.get_h() != b.get_h()) { x = y = -1; return true; }
+  for (y = 0; y < a.get_h(); ++y) {
+    if (std::memcmp(a.row(y), b.row(y), static_cast<size_t>(a.get_stride()) * sizeof(uint64_t)) == 0) { continue; }
+    for (x = 0; x < a.get_w(); ++x) {
+      if (a.get(x, y) != b.get(x, y)) { return true; }
+    }
+  }
+  return false;
+}
+
+inline LifeBoard placed(const LifeBoard &pattern, int w, int h, int ox, int oy) {
+  LifeBoard board(w, h);
+  for (int y = 0; y < pattern.get_h(); ++y) {
+    for (int x = 0; x < pattern.get_w(); ++x) {
+      if (pattern.get(x, y) && x + ox >= 0 && y + oy >= 0 && x + ox < w && y + oy < h) {
+        board.set(x + ox, y + oy, true);
+      }
+    }
+  }
+  return board;
+}
+
+struct Known {
+  const char *name;
+  const char *rle;
+  int period;
+  int dx, dy;  // displacement per period
+};
+
+// Conway patterns; periods and displacements are checked on a roomy board.
+inline const std::vector<Known> &known_patterns() {
+  static const std::vector<Known> patterns {
+    {"blinker", "3o!", 2, 0, 0},
+    {"glider", "bo$2bo$3o!", 4, 1, 1},
+    {"lwss", "bo2bo$o4b$o3bo$4o!", 4, -2, 0},
+    {"pulsar", "2b3o3b3o2$o4bobo4bo$o4bobo4bo$o4bobo4bo$2b3o3b3o2$2b3o3b3o$o4bobo4bo$"
+               "o4bobo4bo$o4bobo4bo2$2b3o3b3o!", 3, 0, 0},
+    {"gun", "24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bo"
+            "bo$10bo5bo7bo$11bo3bo$12b2o!", 30, 0, 0},
+  };
+  return patterns;
+}
+
+class Runner {
+public:
+  explicit Runner(const std::vector<SelftestEngine> &engines) : engines_{engines} {}
+
+  int failures() const { return failures_; }
+  int cases() const { return cases_; }
+
+  // Runs every engine that supports the case against the reference, comparing
+  // after 1, 2, 4, ... generations up to gens.
+  void differential(const char *label, const LifeBoard &start, const Rule &rule, int gens) {
+    ++cases_;
+    for (const SelftestEngine &e : engines_) {
+      if (e.supports && !e.supports(start, rule)) { continue; }
+      LifeBoard expected = start;
+      LifeBoard actual = start;
+      int done {0};
+      for (int chunk = 1; done < gens; chunk *= 2) {
+        const int n = chunk < gens - done ? chunk : gens - done;
+        for (int i = 0; i < n; ++i) { reference_step(expected, rule); }
+        e.run(actual, rule, n);
+        done += n;
+        int x {0}, y {0};
+        if (first_difference(expected, actual, x, y)) {
+          char rule_text[24];
+          format_rule(rule, rule_text);
+          SDL_Log("selftest: %s differs from reference on %s %dx%d %s at generation %d, cell (%d, %d)",
+                  e.name, label, start.get_w(), start.get_h(), rule_text, done, x, y);
+          ++failures_;
+          break;
+        }
+      }
+    }
+  }
+
+  void expect(bool ok, const char *what, const char *label) {
+    ++cases_;
+    if (!ok) {
+      SDL_Log("selftest: %s failed for %s", what, label);
+      ++failures_;
+    }
+  }
+
+private:
+  const std::vector<SelftestEngine> &engines_;
+  int failures_ {0};
+  int cases_ {0};
+};
+
+// Flips, inserts, deletes or repeats a few bytes; biased towards digits and
+// RLE/protocol punctuation so mutants get past the first checks.
+inline void mutate(std::string &s, uint64_t &state) {
+  static const char kBytes[] {'0', '9', '$', '!', 'o', 'b', '=', ',', ';', ' ', '\n', '-', 'x', '#', '\0', '\xff'};
+  auto next = [&state] { state = mix64(state + 0x9e3779b97f4a7c15ull); return state; };
+  const int edits = 1 + static_cast<int>(next() % 4);
+  for (int e = 0; e < edits; ++e) {
+    const size_t at = s.empty() ? 0 : next() % (s.size() + 1);
+    const char c = next() & 1 ? kBytes[next() % sizeof(kBytes)] : static_cast<char>(next());
+    switch (next() % 4) {
+      case 0: if (at < s.size()) { s[at] = c; } break;
+      case 1: s.insert(at, 1, c); break;
+      case 2: if (at < s.size()) { s.erase(at, 1 + next() % 8); } break;
+      default: s.insert(at, std::string(1 + next() % 6, static_cast<char>('0' + next() % 10))); break;
+    }
+  }
+}
+
+} // namespace selftest_detail
+
+// Engines that live next to LifeBoard.
+inline std::vector<SelftestEngine> builtin_engines() {
+  return {
+    {"packed", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      for (int i = 0; i < n; ++i) { b.step(r); }
+    }},
+    // uneven bands, stepped last to first, as threads and shards do
+    {"bands", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      const int h = b.get_h();
+      const int cuts[4] {0, h / 3, h / 3 + (h > 1 ? 1 : 0), h};
+      for (int i = 0; i < n; ++i) {
+        for (int k = 2; k >= 0; --k) { b.step_rows(r, cuts[k], cuts[k + 1]); }
+        b.swap_generation();
+      }
+    }},
+    // fixed bands on pinned pool workers, on a board they placed themselves
+    {"pool", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      BandPool pool(b.get_h(), 3);
+      LifeBoard placed(b.get_w(), b.get_h(), LifeBoard::Untouched {});
+      pool.place(placed);
+      for (int y = 0; y < b.get_h(); ++y) {
+        std::memcpy(placed.row(y), b.row(y), static_cast<size_t>(b.get_stride()) * sizeof(uint64_t));
+      }
+      for (int i = 0; i < n; ++i) { pool.step(placed, r); }
+      b = std::move(placed);
+    }},
+    // temporal blocking, three generations per pass over 5-row tiles, so
+    // halos cross tile edges and reach the board edges
+    {"temporal", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      TemporalScratch scratch;
+      for (int done = 0; done < n;) {
+        const int depth = std::min(3, n - done);
+        step_ahead(b, r, depth, 0, b.get_h(), scratch, 5);
+        b.swap_generation();
+        done += depth;
+      }
+    }},
+    // a dead-edged region covering the whole board, stepped and committed back
+    {"region", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      RegionRun run(b, 0, 0, b.get_w(), b.get_h(), RegionEdge::kDead);
+      run.step(r, static_cast<uint64_t>(n));
+      run.commit(b);
+    }},
+    // the same board as a region at an unaligned spot of a larger one whose
+    // live cells around it must not leak in or be overwritten
+    {"region-offset", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      const int w = b.get_w(), h = b.get_h();
+      LifeBoard big(w + 70, h + 6);
+      big.fill_random(99, 50);
+      copy_cells(b, 0, 0, w, h, big, 37, 3);
+      const LifeBoard before = big;
+      RegionRun run(big, 37, 3, w, h, RegionEdge::kDead);
+      run.step(r, static_cast<uint64_t>(n));
+      run.commit(big);
+      copy_cells(big, 37, 3, w, h, b, 0, 0);
+      copy_cells(before, 37, 3, w, h, big, 37, 3);
+      int x {0}, y {0};
+      if (selftest_detail::first_difference(before, big, x, y)) { b = LifeBoard(1, 1); }
+    }},
+    // only the neighbourhoods of last generation's flips
+    {"change-list", [](const LifeBoard &, const Rule &r) { return ChangeListStepper::supports(r); },
+     [](LifeBoard &b, const Rule &r, int n) {
+      ChangeListStepper stepper;
+      stepper.reset(b);
+      for (int i = 0; i < n; ++i) { stepper.step(b, r); }
+    }},
+    // one lane of a 512-board batch, between lanes running other soups under
+    // another rule that must not leak in
+    {"bit-sliced", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      BatchLife batch(b.get_w(), b.get_h());
+      LifeBoard other(b.get_w(), b.get_h());
+      other.fill_random(n, 50);
+      Rule highlife;
+      parse_rule(r == Rule {} ? "B36/S23" : "B3/S23", highlife);
+      for (int lane : {299, 301}) {
+        batch.set_rule(lane, highlife);
+        batch.load(lane, other);
+      }
+      batch.set_rule(300, r);
+      batch.load(300, b);
+      for (int i = 0; i < n; ++i) { batch.step(); }
+      b = batch.board(300);
+    }},
+    // round-trips through the checkpoint format every step
+    {"checkpoint", nullptr, [](LifeBoard &b, const Rule &r, int n) {
+      for (int i = 0; i < n; ++i) {
+        b.step(r);
+        std::vector<char> data = serialize_checkpoint(b.snapshot(), r, 0);
+        Rule rr;
+        uint64_t gen {0};
+        if (!parse_checkpoint(data.data(), data.size(), b, rr, gen) || !(rr == r)) { b = LifeBoard(1, 1); }
+      }
+    }},
+  };
+}
+
+// Returns the number of failures; 0 means every engine agreed everywhere.
+inline int run_selftest(const std::vector<SelftestEngine> &extra = {}) {
+  using namespace selftest_detail;
+  std::vector<SelftestEngine> engines = builtin_engines();
+  engines.insert(engines.end(), extra.begin(), extra.end());
+  Runner t(engines);
+  const Uint64 start = SDL_GetPerformanceCounter();
+
+  // known patterns: periods and displacements on the reference, then every
+  // engine with the pattern in the middle, on each edge and in each corner
+  for (const Known &k : known_patterns()) {
+    LifeBoard pattern;
+    std::string error;
+    if (!parse_rle(k.rle, SDL_strlen(k.rle), pattern, nullptr, &error)) {
+      t.expect(false, "parsing", k.name);
+      continue;
+    }
+    const int w = pattern.get_w() + 40, h = pattern.get_h() + 40;
+    LifeBoard board = placed(pattern, w, h, 20, 20);
+    LifeBoard later = board;
+    for (int i = 0; i < k.period; ++i) { reference_step(later, Rule {}); }
+    int x {0}, y {0};
+    if (SDL_strcmp(k.name, "gun") == 0) {
+      // the gun itself repeats, plus one new glider
+      t.expect(later.population() == pattern.population() + 5, "one glider per period", k.name);
+    } else {
+      t.expect(!first_difference(later, placed(pattern, w, h, 20 + k.dx, 20 + k.dy), x, y), "period", k.name);
+      const PatternAnalysis a = analyze_pattern(pattern, Rule {});
+      t.expect(a.period == static_cast<uint64_t>(k.period) && a.dx == k.dx && a.dy == k.dy && a.settle == 0,
+               "analyzer period and displacement", k.name);
+    }
+
+    const int gens = k.period * 4 + 8;
+    for (int sx = 0; sx < 3; ++sx) {
+      for (int sy = 0; sy < 3; ++sy) {
+        // 0: flush against the low edge, 1: middle, 2: hanging one cell over the high edge
+        for (int bw : {25, 63, 64, 65, 130}) {
+          const int bh = pattern.get_h() + 12;
+          const int ox = sx == 0 ? 0 : sx == 1 ? (bw - pattern.get_w()) / 2 : bw - pattern.get_w() + 1;
+          const int oy = sy == 0 ? 0 : sy == 1 ? (bh - pattern.get_h()) / 2 : bh - pattern.get_h() + 1;
+          t.differential(k.name, placed(pattern, bw, bh, ox, oy), Rule {}, gens);
+        }
+      }
+    }
+  }
+
+  // the analyzer on things that aren't periodic from the start
+  {
+    struct Case {
+      const char *rle;
+      PatternAnalysis::Kind kind;
+      uint64_t settle, period;
+      const char *velocity;
+    };
+    static const Case kCases[] {
+      {"2o$o!", PatternAnalysis::Kind::kStill, 1, 1, nullptr},        // becomes a block
+      {"o!", PatternAnalysis::Kind::kDies, 1, 0, nullptr},
+      {"3o$o!", PatternAnalysis::Kind::kStill, 3, 1, nullptr},        // becomes a beehive
+      {"3o$bo!", PatternAnalysis::Kind::kOscillator, 9, 2, nullptr},  // becomes a traffic light
+      {"bo$2bo$3o!", PatternAnalysis::Kind::kSpaceship, 0, 4, "c/4 diagonal"},
+      {"bo2bo$o4b$o3bo$4o!", PatternAnalysis::Kind::kSpaceship, 0, 4, "c/2 orthogonal"},
+    };
+    for (const Case &k : kCases) {
+      LifeBoard pattern;
+      parse_rle(k.rle, SDL_strlen(k.rle), pattern);
+      const PatternAnalysis a = analyze_pattern(pattern, Rule {});
+      bool ok = a.kind == k.kind && (k.period == 0 || (a.period == k.period && a.settle == k.settle));
+      if (k.kind == PatternAnalysis::Kind::kDies) { ok = ok && a.settle == k.settle; }
+      if (k.velocity) { ok = ok && format_velocity(a.dx, a.dy, a.period) == k.velocity; }
+      t.expect(ok, "analyzer", k.rle);
+    }
+    AnalyzeLimits limits;
+    limits.max_generations = 200;
+    LifeBoard gun;
+    parse_rle(known_patterns().back().rle, SDL_strlen(known_patterns().back().rle), gun);
+    t.expect(analyze_pattern(gun, Rule {}, limits).kind == PatternAnalysis::Kind::kUnknown, "analyzer", "gun never recurs");
+  }
+
+  // soups across word-boundary widths, degenerate sizes and several rules
+  static const char *const kRules[] {"B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B1357/S1357", "B0/S8"};
+  static const int kSizes[][2] {{1, 1}, {1, 7}, {7, 1}, {2, 2}, {25, 25}, {13, 25}, {25, 9}, {63, 5}, {64, 64}, {65, 17},
+                                {127, 33}, {128, 2}, {129, 3}, {200, 150}, {700, 19}};
+  uint64_t seed {1};
+  for (const char *rule_text : kRules) {
+    Rule rule;
+    parse_rule(rule_text, rule);
+    for (const auto &size : kSizes) {
+      for (int density : {10, 35, 50, 90}) {
+        LifeBoard soup(size[0], size[1]);
+        soup.fill_random(seed++, density);
+        t.differential("soup", soup, rule, 40);
+      }
+    }
+  }
+
+  // every kernel tier this CPU supports against the generic one, on rows wide
+  // enough to reach the vector loops and with ragged ends
+  {
+    const std::vector<CpuKernels> &tiers = cpu_kernel_tiers();
+    uint64_t state {7};
+    for (size_t i = 1; i < tiers.size() && tiers[i].supported(); ++i) {
+      const CpuKernels &g = tiers.front(), &k = tiers[i];
+      bool same {true};
+      for (int w : {1, 64, 65, 200, 576, 577, 640, 1000, 2500}) {
+        LifeBoard board(w, 13);
+        board.fill_random(state++, 40);
+        const LifeBoard &cb = board;
+        const int stride = cb.get_stride();
+        const size_t words = static_cast<size_t>(stride) * 13;
+        std::vector<uint64_t> a(static_cast<size_t>(stride)), b(a.size());
+        const uint16_t birth = static_cast<uint16_t>(mix64(state) & 0x1fe), survive = static_cast<uint16_t>(mix64(~state) & 0x1ff);
+        for (int y = 0; y < 13; ++y) {
+          const uint64_t *above = y > 0 ? cb.row(y - 1) : nullptr, *below = y < 12 ? cb.row(y + 1) : nullptr;
+          g.step_row(above, cb.row(y), below, a.data(), stride, cb.tail_mask(), birth, survive);
+          k.step_row(above, cb.row(y), below, b.data(), stride, cb.tail_mask(), birth, survive);
+          same &= a == b;
+        }
+        same &= g.popcount(cb.row(0), words) == k.popcount(cb.row(0), words);
+        same &= g.popcount(cb.row(0) + 1, words - 1) == k.popcount(cb.row(0) + 1, words - 1);
+        same &= g.hash_rows(cb.row(0), stride, 0, 13, 5) == k.hash_rows(cb.row(0), stride, 0, 13, 5);
+        same &= g.hash_rows(cb.row(0), stride, 2, 11, -3) == k.hash_rows(cb.row(0), stride, 2, 11, -3);
+        for (int scale = 1; scale <= 8; ++scale) {
+          const size_t span = 24 * static_cast<size_t>(scale);
+          std::vector<uint8_t> table(256 * span), pa(static_cast<size_t>(w / 8 + 1) * span), pb(pa.size());
+          for (size_t j = 0; j < table.size(); ++j) { table[j] = static_cast<uint8_t>(j * 7 + j / 251); }
+          const int groups = (w - 3) / 8;
+          g.expand_cells(cb.row(12), stride, 3, groups, table.data(), scale, pa.data());
+          k.expand_cells(cb.row(12), stride, 3, groups, table.data(), scale, pb.data());
+          same &= pa == pb;
+        }
+        // a bit-sliced batch row, at word counts the vectors do and don't divide
+        const int cells = w % 37 + 1;
+        for (int words : {1, 3, 4, 8}) {
+          const size_t n = static_cast<size_t>(cells + 2) * words;
+          std::vector<uint64_t> rows(4 * n), rules(18 * static_cast<size_t>(words));
+          for (size_t j = 0; j < 4; ++j) {
+            for (size_t i = static_cast<size_t>(words); i + words < n; ++i) { rows[j * n + i] = mix64(state++); }
+          }
+          for (uint64_t &r : rules) { r = mix64(state++); }
+          std::vector<uint64_t> oa(n), ob(n), ca(2 * static_cast<size_t>(words)), cb2(ca.size());
+          const uint64_t *first = rows.data() + words;
+          g.step_sliced(first, first + n, first + 2 * n, first + 3 * n, oa.data() + words, cells, words,
+                        rules.data(), rules.data() + 9 * words, ca.data(), ca.data() + words);
+          k.step_sliced(first, first + n, first + 2 * n, first + 3 * n, ob.data() + words, cells, words,
+                        rules.data(), rules.data() + 9 * words, cb2.data(), cb2.data() + words);
+          same &= oa == ob && ca == cb2;
+        }
+      }
+      t.expect(same, "kernel tier matches generic", k.name);
+    }
+  }
+
+  // the parallel_for backend against one thread, on a board big enough to be
+  // split into several slices
+  {
+    LifeBoard board(2048, 1024);
+    board.fill_random(11, 35);
+    LifeBoard serial = board;
+    for (int i = 0; i < 6; ++i) {
+      board.step_parallel(Rule {});
+      serial.step(Rule {});
+    }
+    const LifeBoard &cs = serial;
+    const size_t words = static_cast<size_t>(cs.get_stride()) * cs.get_h();
+    int x {0}, y {0};
+    t.expect(!first_difference(board, serial, x, y) &&
+             board.population() == cpu_kernels().popcount(cs.row(0), words) &&
+             board.hash(3) == cpu_kernels().hash_rows(cs.row(0), cs.get_stride(), 0, cs.get_h(), 3),
+             "parallel step and census", parallel_backend());
+  }
+
+  // additive hashing: bands hashed with their offsets sum to the whole
+  {
+    LifeBoard board(150, 97);
+    board.fill_random(99, 40);
+    LifeBoard top(150, 40), bottom(150, 57);
+    for (int y = 0; y < 97; ++y) {
+      LifeBoard &band = y < 40 ? top : bottom;
+      std::memcpy(band.row(y < 40 ? y : y - 40), board.row(y), static_cast<size_t>(board.get_stride()) * sizeof(uint64_t));
+    }
+    t.expect(top.hash(0) + bottom.hash(40) == board.hash(), "band hashes adding up", "150x97 soup");
+  }
+
+  // copy-on-write: stepping the board or editing a copy leaves a snapshot alone
+  {
+    LifeBoard board(100, 60);
+    board.fill_random(3, 40);
+    const uint64_t before = board.hash();
+    BoardSnapshot snap = board.snapshot();
+    LifeBoard copy = board;
+    board.step(Rule {});
+    copy.set(1, 1, !copy.get(1, 1));
+    uint64_t after {0};
+    for (int y = 0; y < snap.height; ++y) { after += hash_row(snap.row(y), snap.stride, y); }
+    t.expect(after == before, "snapshot isolation", "100x60 soup");
+  }
+
+  // RLE round trip
+  {
+    LifeBoard board(131, 45);
+    board.fill_random(5, 30);
+    const std::string rle = write_rle(board, Rule {});
+    LifeBoard back;
+    int x {0}, y {0};
+    t.expect(parse_rle(rle.data(), rle.size(), back) && !first_difference(board, back, x, y),
+             "RLE round trip", "131x45 soup");
+  }
+
+  // hostile input: pathological files are rejected outright, and mutants of
+  // valid ones either parse within the limits or fail cleanly. Build with
+  // AUTO_CELL_SANITIZE to have memory errors abort the run.
+  {
+    PatternLimits limits;
+    limits.max_width = limits.max_height = 4096;
+    limits.max_cells = int64_t {1} << 20;
+    static const char *const kRejected[] {
+      "x = 65536, y = 65536\n!", "x = 4096, y = 4096\n!", "x = -5, y = 3\no!", "99999999999999999999o!",
+      "4097o!", "4096$o!", "2048o$2048$o!", "x = 3\n", "o?o!",
+    };
+    for (const char *rle : kRejected) {
+      LifeBoard board;
+      t.expect(!parse_rle(rle, SDL_strlen(rle), board, nullptr, nullptr, limits), "rejecting a pathological RLE", rle);
+    }
+
+    // linear time: a long body of maximal runs costs words, not cells
+    std::string wide;
+    for (int y = 0; y < 256; ++y) { wide += "4096o$"; }
+    wide += "!";
+    LifeBoard board;
+    t.expect(parse_rle(wide.data(), wide.size(), board, nullptr, nullptr, limits) &&
+             board.population() == 256u * 4096u, "parsing maximal runs", "256 rows of 4096o");
+
+    uint64_t state {42};
+    int accepted {0};
+    for (const Known &k : known_patterns()) {
+      for (int i = 0; i < 400; ++i) {
+        std::string rle = std::string("x = 40, y = 20, rule = B3/S23\n") + k.rle;
+        mutate(rle, state);
+        LifeBoard out;
+        Rule rule;
+        if (parse_rle(rle.data(), rle.size(), out, &rule, nullptr, limits)) {
+          ++accepted;
+          t.expect(out.get_w() <= limits.max_width && out.get_h() <= limits.max_height &&
+                   static_cast<int64_t>(out.get_w()) * out.get_h() <= limits.max_cells, "mutated RLE within limits", k.name);
+        }
+      }
+    }
+
+    LifeBoard soup(70, 30);
+    soup.fill_random(8, 40);
+    const std::vector<char> good = serialize_checkpoint(soup.snapshot(), Rule {}, 77);
+    for (int i = 0; i < 2000; ++i) {
+      std::string data(good.begin(), good.end());
+      mutate(data, state);
+      LifeBoard out;
+      Rule rule;
+      uint64_t gen {0};
+      if (parse_checkpoint(data.data(), data.size(), out, rule, gen)) {
+        int x {0}, y {0};
+        t.expect(!first_difference(out, soup, x, y) && gen == 77, "accepting only intact checkpoints", "70x30 soup");
+      }
+    }
+    // a well-formed file whose rows have cells past the width
+    LifeBoard ghost = soup;
+    ghost.row(3)[ghost.get_stride() - 1] |= ~ghost.tail_mask();
+    const std::vector<char> bad = serialize_checkpoint(ghost.snapshot(), Rule {}, 77);
+    LifeBoard out;
+    Rule rule;
+    uint64_t gen {0};
+    t.expect(!parse_checkpoint(bad.data(), bad.size(), out, rule, gen), "rejecting cells past the width", "70x30 soup");
+    SDL_Log("selftest: %d of %d mutated RLE files parsed within limits", accepted,
+            static_cast<int>(known_patterns().size()) * 400);
+  }
+
+  // torus regions against a wrapping reference, at unaligned offsets of a
+  // board that must come out unchanged outside the region
+  for (const auto &size : {std::pair<int, int> {1, 1}, {3, 2}, {7, 9}, {63, 5}, {64, 4}, {65, 11}, {130, 20}}) {
+    for (const char *rule_text : {"B3/S23", "B36/S23", "B2/S"}) {
+      Rule rule;
+      parse_rule(rule_text, rule);
+      LifeBoard board(size.first + 80, size.second + 4);
+      board.fill_random(seed++, 40);
+      LifeBoard expected(size.first, size.second);
+      copy_cells(board, 13, 2, size.first, size.second, expected, 0, 0);
+      RegionRun run(board, 13, 2, size.first, size.second, RegionEdge::kTorus);
+      for (int g = 0; g < 30; ++g) { reference_torus_step(expected, rule); }
+      run.step(rule, 30);
+      int x {0}, y {0};
+      t.expect(!first_difference(run.cells(), expected, x, y) && run.population() == expected.population(),
+               "torus region", rule_text);
+      LifeBoard committed = board;
+      run.commit(committed);
+      LifeBoard inside(size.first, size.second);
+      copy_cells(committed, 13, 2, size.first, size.second, inside, 0, 0);
+      copy_cells(board, 13, 2, size.first, size.second, committed, 13, 2);
+      t.expect(!first_difference(inside, expected, x, y) && !first_difference(committed, board, x, y),
+               "committing a torus region", rule_text);
+    }
+  }
+
+  // batch lanes settle exactly when their board repeats, each under its own
+  // rule, and a reloaded lane starts over
+  {
+    static const char *const kLaneRules[] {"B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B1357/S1357", "B0/S8", "B3/S012345678"};
+    constexpr int kRules = static_cast<int>(sizeof(kLaneRules) / sizeof(kLaneRules[0]));
+    BatchLife batch(12, 10, 2);
+    std::vector<Rule> rules(static_cast<size_t>(batch.lanes()));
+    std::vector<LifeBoard> now(rules.size()), last(rules.size()), before(rules.size());
+    std::vector<bool> done(rules.size());
+    for (int lane = 0; lane < batch.lanes(); ++lane) {
+      parse_rule(kLaneRules[lane % kRules], rules[static_cast<size_t>(lane)]);
+      batch.set_rule(lane, rules[static_cast<size_t>(lane)]);
+      LifeBoard soup(12, 10);
+      soup.fill_random(seed++, 10 + lane % 60);
+      now[static_cast<size_t>(lane)] = soup;
+      batch.load(lane, soup);
+    }
+    bool ok = batch.busy_count() == batch.lanes() && batch.rule(5).birth == rules[5].birth;
+    int settled {0};
+    for (int g = 1; g <= 200 && ok; ++g) {
+      batch.step();
+      for (int lane = 0; lane < batch.lanes(); ++lane) {
+        const size_t i = static_cast<size_t>(lane);
+        if (done[i]) { continue; }
+        before[i] = last[i];
+        last[i] = now[i];
+        reference_step(now[i], rules[i]);
+        int x {0}, y {0};
+        const bool p1 = !first_difference(now[i], last[i], x, y);
+        const bool p2 = !p1 && g >= 2 && !first_difference(now[i], before[i], x, y);
+        ok &= !first_difference(batch.board(lane), now[i], x, y) && batch.age(lane) == static_cast<uint64_t>(g);
+        ok &= batch.settled(lane) == (p1 || p2);
+        if (p1 || p2) {
+          ok &= batch.period(lane) == (p1 ? 1 : 2) && batch.settle_generation(lane) == static_cast<uint64_t>(g - (p1 ? 1 : 2));
+          done[i] = true;
+          ++settled;
+        }
+      }
+    }
+    t.expect(ok && settled > batch.lanes() / 2, "batch lanes settle with their board", "12x10");
+
+    LifeBoard blinker(12, 10);
+    blinker.set_span(4, 4, 3);
+    batch.set_rule(7, Rule {});
+    batch.load(7, blinker);
+    batch.clear(8);
+    for (int g = 0; g < 3; ++g) { batch.step(); }
+    t.expect(batch.settled(7) && batch.period(7) == 2 && batch.settle_generation(7) == 0 && batch.age(7) == 3 &&
+             batch.population(7) == 3 && !batch.busy(8) && batch.busy_count() == batch.lanes() - 1,
+             "reloading a batch lane", "blinker");
+  }
+
+  // a rule sweep against each soup stepped on its own board, with more soups
+  // than lanes so lanes get reloaded under other rules, then the file
+  {
+    SweepOptions opt;
+    parse_rule("B3/S2", opt.require);
+    parse_rule("B012457/S015678", opt.exclude);  // 16 rules, B3/S2 with any of B6, B8, S3 and S4
+    opt.size = 20;
+    opt.soups = 40;
+    opt.generations = 90;
+    opt.words = 1;
+    opt.seed = seed;
+    seed += static_cast<uint64_t>(opt.soups);
+    const SweepResults res = sweep_rule_space(opt);
+    const int half = opt.generations / 2;
+    bool ok = res.rows() == 16;
+    for (size_t row = 0; row < res.rows() && ok; ++row) {
+      const Rule rule = rule_from_index(res.rule[row]);
+      int count[kSweepClasses] {};
+      int period {0};
+      float population {0};
+      for (int i = 0; i < opt.soups; ++i) {
+        LifeBoard patch(10, 10);
+        patch.fill_random(opt.seed + static_cast<uint64_t>(i), opt.density);
+        LifeBoard b(20, 20);
+        copy_cells(patch, 0, 0, 10, 10, b, 5, 5);
+        const uint64_t initial = b.population();
+        std::vector<LifeBoard> seen {b};
+        SweepClass c {SweepClass::kChaotic};
+        int p {0};
+        for (int g = 1;; ++g) {
+          reference_step(b, rule);
+          int x {0}, y {0};
+          if (!first_difference(b, seen[static_cast<size_t>(g - 1)], x, y)) {
+            c = b.population() ? SweepClass::kStable : SweepClass::kDies;
+            p = b.population() ? 1 : 0;
+          } else if (g >= 2 && !first_difference(b, seen[static_cast<size_t>(g - 2)], x, y)) {
+            c = SweepClass::kOscillating;
+            p = 2;
+          } else if (g > half && !first_difference(b, seen[static_cast<size_t>(half)], x, y)) {
+            c = SweepClass::kOscillating;
+            p = g - half;
+          } else if (g >= opt.generations) {
+            c = b.population() >= 2 * std::max<uint64_t>(initial, 1) ? SweepClass::kExploding : SweepClass::kChaotic;
+          } else {
+            seen.push_back(b);
+            continue;
+          }
+          break;
+        }
+        ++count[static_cast<int>(c)];
+        period = std::max(period, p);
+        population += static_cast<float>(b.population());
+      }
+      int best {0};
+      for (int c = 0; c < kSweepClasses; ++c) {
+        ok &= res.count[c][row] == count[c];
+        if (count[c] >= count[best]) { best = c; }
+      }
+      ok &= res.behavior[row] == best && res.period[row] == period && res.population[row] == population / opt.soups;
+    }
+    t.expect(ok, "rule sweep classes", "B3/S2 family");
+
+    const std::vector<char> file = serialize_sweep(res, opt);
+    SweepResults back;
+    SweepOptions back_opt;
+    t.expect(parse_sweep(file.data(), file.size(), back, back_opt) && back.rule == res.rule &&
+             back.behavior == res.behavior && back.population == res.population && back.count[4] == res.count[4] &&
+             back_opt.seed == opt.seed && back_opt.generations == opt.generations, "sweep file round trip", "16 rules");
+    std::vector<char> damaged = file;
+    damaged[damaged.size() - 3] ^= 1;
+    t.expect(!parse_sweep(damaged.data(), damaged.size(), back, back_opt), "rejecting a damaged sweep file", "16 rules");
+  }
+
+  // change lists on a big, nearly empty board: one stepper carried across a
+  // rule switch, with work that follows the flips rather than the board size
+  {
+    LifeBoard gun;
+    parse_rle(known_patterns().back().rle, SDL_strlen(known_patterns().back().rle), gun);
+    LifeBoard sparse = placed(gun, 2000, 700, 1000, 20);
+    LifeBoard packed = sparse;
+    ChangeListStepper stepper;
+    stepper.reset(sparse);
+    Rule highlife;
+    parse_rule("B36/S23", highlife);
+    size_t most {0};  // cells looked at in the busiest generation
+    for (int g = 0; g < 400; ++g) {
+      const Rule &rule = g < 300 ? Rule {} : highlife;
+      stepper.step(sparse, rule);
+      packed.step(rule);
+      most = std::max(most, stepper.evaluated());
+    }
+    int x {0}, y {0};
+    t.expect(!first_difference(sparse, packed, x, y), "change list on a gun", "B3/S23 then B36/S23");
+    t.expect(most < 10000, "change list work per generation", "gun");
+  }
+
+#if defined(AUTO_CELL_HAS_CONTROL)
+  // the control protocol over a real socket, fed mutated commands; every
+  // batch must leave the server answering a final "gen"
+  {
+    const std::string path = "/tmp/auto_cell_selftest_" + std::to_string(static_cast<long long>(getpid())) + ".sock";
+    ControlServer server;
+    BoardTarget target {LifeBoard(64, 48)};
+    if (!server.listen(("unix:" + path).c_str())) {
+      t.expect(false, "listening", path.c_str());
+    } else {
+      static const char *const kCommands[] {
+        "size", "clear", "load 3 4 bo$2bo$3o!", "load -2147483648 5 o!", "load 0 0 x = 65536, y = 65536", "step 3",
+        "pop", "gen", "run", "pause", "dump 0 0 10 10", "dump 2147483647 0 2147483647 1", "dump -1 -1 5 5", "bogus",
+        "roi 2 3 20 10 torus", "roi-step 5", "roi-dump", "roi-commit", "roi 0 0 64 48", "roi-discard", "roi-step 1",
+      };
+      uint64_t state {7};
+      int answered {0};
+      for (int batch = 0; batch < 40; ++batch) {
+        std::string payload;
+        for (const char *cmd : kCommands) {
+          std::string line = cmd;
+          if (!std::strstr(cmd, "step")) { mutate(line, state); }  // counts stay small
+          payload += line + "\n";
+        }
+        payload += "\ngen\n";
+        sockaddr_un addr {};
+        addr.sun_family = AF_UNIX;
+        SDL_strlcpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path));
+        const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+          if (fd >= 0) { close(fd); }
+          continue;
+        }
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        size_t sent {0};
+        std::string replies;
+        for (int round = 0; round < 200; ++round) {
+          if (sent < payload.size()) {
+            ssize_t n = send(fd, payload.data() + sent, payload.size() - sent, MSG_NOSIGNAL);
+            if (n > 0) { sent += static_cast<size_t>(n); }
+          }
+          server.poll(target);
+          char buf[4096];
+          ssize_t n;
+          while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) { replies.append(buf, static_cast<size_t>(n)); }
+          const std::string tail = "\nok " + std::to_string(static_cast<unsigned long long>(target.generation())) + "\n";
+          if (sent == payload.size() && replies.size() >= tail.size() &&
+              replies.compare(replies.size() - tail.size(), tail.size(), tail) == 0) {
+            ++answered;
+            break;
+          }
+        }
+        close(fd);
+      }
+      t.expect(answered == 40, "answering after hostile commands", "control server");
+    }
+  }
+  // a region taken before the board is laid out again must not be written back
+  {
+    struct Resizing : BoardTarget {
+      Resizing() : BoardTarget(LifeBoard(64, 48)) {}
+      void step(int) override { static_cast<BoardTarget &>(*this) = BoardTarget(LifeBoard(80, 60)); }
+    } target;
+    ControlServer server;
+    static const char kScript[] = "load 2 3 3o!; roi 0 0 10 10; step 1; roi-commit; pop";
+    const std::string replies = server.run_script(target, kScript, sizeof(kScript) - 1);
+    t.expect(replies == "ok\nok\nok 0\nerr board resized since roi\nok 0\n", "roi-commit after a resize", "control server");
+  }
+#endif
+
+#if defined(__linux__)
+  // the sharded runner checks itself against a single board every generation
+  for (int shards : {2, 3, 5}) {
+    ShardOptions opt;
+    opt.width = 97;
+    opt.height = 61;
+    opt.shards = shards;
+    opt.generations = 30;
+    opt.seed = static_cast<uint64_t>(shards);
+    opt.verify = true;
+    t.expect(run_sharded(opt) == 0, "sharded run", "97x61 soup");
+  }
+#endif
+
+  const double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  SDL_Log("selftest: %d checks over %d engines, %d failed, %.2f s",
+          t.cases(), static_cast<int>(engines.size()), t.failures(), seconds);
+  return t.failures();
+}
@@ -0,0 +1,92 @@
+#pragma once
+// Per-generation population, births and deaths, kept in a fixed-size ring.
+//
+// One thread writes with push(): five release stores (plain moves on x86),
+// no locks and no allocation, so it costs a few nanoseconds per generation.
+// Any number of threads may read() at the same time; a reader
+// copies the newest samples and then drops any the writer overwrote while
+// it was copying, so it never sees a torn sample. When the ring is full the
+// oldest samples are overwritten.
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct SeriesSample {
+  uint64_t generation {0};
+  uint64_t population {0};
+  uint64_t births {0};
+  uint64_t deaths {0};
+};
+
+template <size_t N>
+class SeriesRing {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+  static constexpr size_t capacity() { return N; }
+
+  void push(const SeriesSample &s) {
+    const uint64_t h = head_.load(std::memory_order_relaxed);
+    Slot &slot = slots_[h & (N - 1)];
+    slot.generation.store(s.generation, std::memory_order_release);
+    slot.population.store(s.population, std::memory_order_release);
+    slot.births.store(s.births, std::memory_order_release);
+    slot.deaths.store(s.deaths, std::memory_order_release);
+    head_.store(h + 1, std::memory_order_release);
+  }
+
+  // Samples pushed so far, including overwritten ones.
+  uint64_t pushed() const { return head_.load(std::memory_order_acquire); }
+
+  // Appends up to max of the newest samples to out, oldest first; at most
+  // N - 1, since the slot the writer fills next may be half written.
+  void read(std::vector<SeriesSample> &out, size_t max = N) const {
+    const uint64_t end = head_.load(std::memory_order_acquire);
+    const uint64_t n = std::min<uint64_t>({end, static_cast<uint64_t>(max), N});
+    const size_t base = out.size();
+    for (uint64_t i = end - n; i < end; ++i) {
+      const Slot &slot = slots_[i & (N - 1)];
+      // a value from a lapping push brings its head update along with it
+      out.push_back({slot.generation.load(std::memory_order_acquire), slot.population.load(std::memory_order_acquire),
+                     slot.births.load(std::memory_order_acquire), slot.deaths.load(std::memory_order_acquire)});
+    }
+    // the writer may have lapped the oldest slots while they were copied; the
+    // one it writes next (index `now`) evicts index now - N
+    const uint64_t now = head_.load(std::memory_order_relaxed);
+    const uint64_t first_valid = now >= N ? now - N + 1 : 0;
+    const uint64_t start = end - n;
+    if (first_valid > start) {
+      const size_t drop = static_cast<size_t>(std::min<uint64_t>(first_valid - start, n));
+      out.erase(out.begin() + static_cast<std::ptrdiff_t>(base), out.begin() + static_cast<std::ptrdiff_t>(base + drop));
+    }
+  }
+
+  void clear() { head_.store(0, std::memory_order_release); }
+
+private:
+  struct Slot {
+    std::atomic<uint64_t> generation {0};
+    std::atomic<uint64_t> population {0};
+    std::atomic<uint64_t> births {0};
+    std::atomic<uint64_t> deaths {0};
+  };
+
+  alignas(64) std::atomic<uint64_t> head_ {0};
+  alignas(64) Slot slots_[N];
+};
+
+// "generation,population,births,deaths" lines with a header.
+inline std::string series_csv(const std::vector<SeriesSample> &samples) {
+  std::string csv = "generation,population,births,deaths\n";
+  char line[96];
+  for (const SeriesSample &s : samples) {
+    const int n = std::snprintf(line, sizeof(line), "%llu,%llu,%llu,%llu\n",
+                                static_cast<unsigned long long>(s.generation), static_cast<unsigned long long>(s.population),
+                                static_cast<unsigned long long>(s.births), static_cast<unsigned long long>(s.deaths));
+    csv.append(line, static_cast<size_t>(n));
+  }
+  return csv;
+}
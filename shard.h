@@ -0,0 +1,288 @@
+#pragma once
+// Multi-process sharded stepping. The board is split into horizontal bands,
+// one forked worker per band. Neighboring workers swap one-row halos over
+// Unix-domain socketpairs every generation; interiors are stepped while the
+// halos are in flight. A coordinator sums per-shard population and hashes.
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "life_board.h"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+struct ShardOptions {
+  int      width       {1024};
+  int      height      {1024};
+  int      shards      {2};
+  int      generations {100};
+  uint64_t seed        {1};
+  int      density     {35};   // percent of live cells in the initial soup
+  bool     verify      {false}; // step a single-process board alongside and compare
+};
+
+// per-generation report sent from a worker to the coordinator
+struct ShardReport {
+  uint64_t generation;
+  uint64_t population;
+  uint64_t hash;
+};
+
+#if defined(__linux__)
+
+namespace shard_detail {
+
+inline bool write_all(int fd, const void *data, size_t size) {
+  const char *p = static_cast<const char *>(data);
+  while (size > 0) {
+    ssize_t n = write(fd, p, size);
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) { return false; }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+inline bool read_all(int fd, void *data, size_t size) {
+  char *p = static_cast<char *>(data);
+  while (size > 0) {
+    ssize_t n = read(fd, p, size);
+    if (n < 0 && errno == EINTR) { continue; }
+    if (n <= 0) { return false; }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// one direction of halo traffic with a neighbor shard
+struct HaloLink {
+  int         fd {-1};
+  const char *send_ptr {nullptr};
+  size_t      send_left {0};
+  char       *recv_ptr {nullptr};
+  size_t      recv_left {0};
+
+  void start(const uint64_t *send_row, uint64_t *recv_row, size_t bytes) {
+    send_ptr  = reinterpret_cast<const char *>(send_row);
+    send_left = bytes;
+    recv_ptr  = reinterpret_cast<char *>(recv_row);
+    recv_left = bytes;
+  }
+
+  // moves as many bytes as the socket accepts without blocking
+  bool pump() {
+    while (send_left > 0) {
+      ssize_t n = send(fd, send_ptr, send_left, MSG_DONTWAIT | MSG_NOSIGNAL);
+      if (n < 0) {
+        if (errno == EINTR) { continue; }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+        return false;
+      }
+      send_ptr += n;
+      send_left -= static_cast<size_t>(n);
+    }
+    while (recv_left > 0) {
+      ssize_t n = recv(fd, recv_ptr, recv_left, MSG_DONTWAIT);
+      if (n < 0) {
+        if (errno == EINTR) { continue; }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+        return false;
+      }
+      if (n == 0) { return false; }  // neighbor went away
+      recv_ptr += n;
+      recv_left -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  bool done() const { return fd < 0 || (send_left == 0 && recv_left == 0); }
+};
+
+// finishes all outstanding halo transfers, sleeping in poll() while waiting
+inline bool finish_halos(HaloLink *links, int count) {
+  for (;;) {
+    pollfd fds[2];
+    int nfds {0};
+    for (int i = 0; i < count; ++i) {
+      if (links[i].done()) { continue; }
+      if (!links[i].pump()) { return false; }
+      if (links[i].done()) { continue; }
+      short events = static_cast<short>((links[i].send_left ? POLLOUT : 0) | (links[i].recv_left ? POLLIN : 0));
+      fds[nfds++] = {links[i].fd, events, 0};
+    }
+    if (nfds == 0) { return true; }
+    if (poll(fds, static_cast<nfds_t>(nfds), -1) < 0 && errno != EINTR) { return false; }
+  }
+}
+
+inline int shard_worker(const ShardOptions &opt, int y0, int y1, int north_fd, int south_fd, int report_fd) {
+  const Rule rule {};
+  LifeBoard band(opt.width, y1 - y0);
+  band.fill_random(opt.seed, opt.density, y0);
+
+  const int stride = band.get_stride();
+  const size_t row_bytes = sizeof(uint64_t) * static_cast<size_t>(stride);
+  std::vector<uint64_t> north_halo(static_cast<size_t>(stride));
+  std::vector<uint64_t> south_halo(static_cast<size_t>(stride));
+  const int last = band.get_h() - 1;
+
+  for (int gen = 1; gen <= opt.generations; ++gen) {
+    HaloLink links[2];
+    int nlinks {0};
+    if (north_fd >= 0) {
+      links[nlinks] = {};
+      links[nlinks].fd = north_fd;
+      links[nlinks++].start(band.row(0), north_halo.data(), row_bytes);
+    }
+    if (south_fd >= 0) {
+      links[nlinks] = {};
+      links[nlinks].fd = south_fd;
+      links[nlinks++].start(band.row(last), south_halo.data(), row_bytes);
+    }
+    for (int i = 0; i < nlinks; ++i) {
+      if (!links[i].pump()) { return 1; }
+    }
+
+    // interior rows only depend on local data
+    if (last >= 2) { band.step_rows(rule, 1, last); }
+
+    if (!finish_halos(links, nlinks)) { return 1; }
+    const uint64_t *north = north_fd >= 0 ? north_halo.data() : nullptr;
+    const uint64_t *south = south_fd >= 0 ? south_halo.data() : nullptr;
+    band.step_rows(rule, 0, 1, north, south);
+    if (last > 0) { band.step_rows(rule, last, last + 1, north, south); }
+    band.swap_generation();
+
+    ShardReport report {static_cast<uint64_t>(gen), band.population(), band.hash(y0)};
+    if (!write_all(report_fd, &report, sizeof(report))) { return 1; }
+  }
+  return 0;
+}
+
+} // namespace shard_detail
+
+// Forks opt.shards workers and coordinates them. Returns 0 on success.
+inline int run_sharded(const ShardOptions &opt) {
+  using namespace shard_detail;
+  const int n = opt.shards;
+  if (n < 1 || n > opt.height || opt.width < 1) {
+    SDL_Log("shard: need 1 <= shards (%d) <= height (%d) and width >= 1", n, opt.height);
+    return 1;
+  }
+
+  // halo[i] connects shard i (south side, [0]) with shard i+1 (north side, [1])
+  std::vector<int> halo(2 * static_cast<size_t>(n), -1);
+  std::vector<int> report(2 * static_cast<size_t>(n), -1);
+  for (int i = 0; i < n; ++i) {
+    if ((i + 1 < n && socketpair(AF_UNIX, SOCK_STREAM, 0, &halo[2 * i]) < 0) ||
+        socketpair(AF_UNIX, SOCK_STREAM, 0, &report[2 * i]) < 0) {
+      SDL_Log("shard: socketpair failed: %s", strerror(errno));
+      return 1;
+    }
+  }
+
+  std::vector<pid_t> pids;
+  for (int i = 0; i < n; ++i) {
+    const int y0 = static_cast<int>(static_cast<int64_t>(opt.height) * i / n);
+    const int y1 = static_cast<int>(static_cast<int64_t>(opt.height) * (i + 1) / n);
+    pid_t pid = fork();
+    if (pid < 0) {
+      SDL_Log("shard: fork failed: %s", strerror(errno));
+      break;
+    }
+    if (pid == 0) {
+      int north_fd = i > 0     ? halo[2 * (i - 1) + 1] : -1;
+      int south_fd = i + 1 < n ? halo[2 * i]           : -1;
+      int report_fd = report[2 * i + 1];
+      for (int fd : halo)   { if (fd >= 0 && fd != north_fd && fd != south_fd) { close(fd); } }
+      for (int fd : report) { if (fd != report_fd) { close(fd); } }
+      _exit(shard_worker(opt, y0, y1, north_fd, south_fd, report_fd));
+    }
+    pids.push_back(pid);
+  }
+  for (int fd : halo) { if (fd >= 0) { close(fd); } }
+  for (int i = 0; i < n; ++i) { close(report[2 * i + 1]); }
+
+  LifeBoard reference;
+  if (opt.verify) {
+    reference = LifeBoard(opt.width, opt.height);
+    reference.fill_random(opt.seed, opt.density);
+  }
+
+  int rc = static_cast<int>(pids.size()) == n ? 0 : 1;
+  const Uint64 start = SDL_GetPerformanceCounter();
+  ShardReport total {};
+  std::vector<ShardReport> reports(static_cast<size_t>(n));
+  for (int gen = 1; rc == 0 && gen <= opt.generations; ++gen) {
+    total = {static_cast<uint64_t>(gen), 0, 0};
+    for (int i = 0; i < n; ++i) {
+      ShardReport &r = reports[static_cast<size_t>(i)];
+      if (!read_all(report[2 * i], &r, sizeof(r)) || r.generation != total.generation) {
+        SDL_Log("shard: lost worker %d at generation %d", i, gen);
+        rc = 1;
+        break;
+      }
+      total.population += r.population;
+      total.hash += r.hash;
+    }
+    if (rc == 0 && opt.verify) {
+      reference.step(Rule{});
+      const uint64_t population = reference.population(), hash = reference.hash();
+      if (population != total.population || hash != total.hash) {
+        SDL_Log("shard: mismatch at generation %d: population %llu vs %llu, hash %016llx vs %016llx (shards vs reference)",
+                gen, static_cast<unsigned long long>(total.population), static_cast<unsigned long long>(population),
+                static_cast<unsigned long long>(total.hash), static_cast<unsigned long long>(hash));
+        // reports only carry sums, so narrow it down to the first band that disagrees
+        for (int i = 0; i < n; ++i) {
+          const int y0 = static_cast<int>(static_cast<int64_t>(opt.height) * i / n);
+          const int y1 = static_cast<int>(static_cast<int64_t>(opt.height) * (i + 1) / n);
+          const uint64_t band_pop = cpu_kernels().popcount(reference.row(y0), static_cast<size_t>(y1 - y0) * reference.get_stride());
+          const uint64_t band_hash = cpu_kernels().hash_rows(reference.row(0), reference.get_stride(), y0, y1, 0);
+          const ShardReport &r = reports[static_cast<size_t>(i)];
+          if (r.population != band_pop || r.hash != band_hash) {
+            SDL_Log("shard: first differing band is shard %d, rows %d to %d: population %llu vs %llu, hash %016llx vs %016llx",
+                    i, y0, y1 - 1, static_cast<unsigned long long>(r.population), static_cast<unsigned long long>(band_pop),
+                    static_cast<unsigned long long>(r.hash), static_cast<unsigned long long>(band_hash));
+            break;
+          }
+        }
+        rc = 1;
+      }
+    }
+  }
+  const double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+  for (int i = 0; i < n; ++i) { close(report[2 * i]); }
+  for (pid_t pid : pids) {
+    int status {0};
+    while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) { rc = 1; }
+  }
+
+  if (rc == 0) {
+    SDL_Log("shard: %d shards, %dx%d, generation %llu, population %llu, hash %016llx, %.3f s%s",
+            n, opt.width, opt.height,
+            static_cast<unsigned long long>(total.generation),
+            static_cast<unsigned long long>(total.population),
+            static_cast<unsigned long long>(total.hash), seconds,
+            opt.verify ? " (verified)" : "");
+  }
+  return rc;
+}
+
+#else
+
+inline int run_sharded(const ShardOptions &) {
+  SDL_Log("shard: sharded mode is only available on Linux");
+  return 1;
+}
+
+#endif
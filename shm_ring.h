@@ -0,0 +1,270 @@
+#pragma once
+// POSIX shared-memory ring of packed boards. A headless run publishes into it
+// at display rate; viewers map it read-only and render straight from a slot.
+// Each slot carries a seqlock: odd while the writer fills it, bumped to the
+// next even value once complete, so readers can tell a torn frame.
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include "life_board.h"
+
+#if defined(__linux__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+struct ShmRingHeader {
+  std::atomic<uint32_t> magic;
+  uint32_t slots;
+  int32_t  width;
+  int32_t  height;
+  int32_t  stride;
+  uint32_t reserved;
+  std::atomic<uint64_t> published;  // number of frames published so far
+};
+
+struct ShmSlotHeader {
+  std::atomic<uint64_t> seq;
+  uint64_t generation;
+  uint64_t population;
+  uint64_t reserved;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shm ring needs lock-free 64-bit atomics");
+
+constexpr uint32_t kShmRingMagic {0x41434c31};  // "ACL1"
+constexpr uint32_t kShmRingSlots {4};
+
+// A consistent view of one published frame. Valid until the writer laps the
+// ring; check ShmRingReader::still_valid() after using it.
+struct ShmFrame {
+  const uint64_t *bits {nullptr};
+  int      width {0};
+  int      height {0};
+  int      stride {0};
+  uint64_t generation {0};
+  uint64_t population {0};
+  uint64_t seq {0};
+  const ShmSlotHeader *slot {nullptr};
+
+  bool get(int x, int y) const {
+    return (bits[static_cast<size_t>(y) * stride + (x >> 6)] >> (x & 63)) & 1u;
+  }
+};
+
+#if defined(__linux__)
+
+namespace shm_detail {
+
+inline size_t slot_bytes(int stride, int height) {
+  return sizeof(ShmSlotHeader) + sizeof(uint64_t) * static_cast<size_t>(stride) * height;
+}
+
+inline size_t ring_bytes(int stride, int height) {
+  return sizeof(ShmRingHeader) + kShmRingSlots * slot_bytes(stride, height);
+}
+
+} // namespace shm_detail
+
+class ShmRingWriter {
+public:
+  ShmRingWriter() = default;
+  ShmRingWriter(const ShmRingWriter&) = delete;
+  ~ShmRingWriter() { close_(); }
+
+  bool open(const char *name, const LifeBoard &board) {
+    close_();
+    size_ = shm_detail::ring_bytes(board.get_stride(), board.get_h());
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0) {
+      SDL_Log("shm: shm_open(%s) failed: %s", name, strerror(errno));
+      return false;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) < 0) {
+      SDL_Log("shm: ftruncate failed: %s", strerror(errno));
+      ::close(fd);
+      shm_unlink(name);
+      return false;
+    }
+    void *p = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+      SDL_Log("shm: mmap failed: %s", strerror(errno));
+      shm_unlink(name);
+      return false;
+    }
+    base_ = static_cast<char *>(p);
+    SDL_strlcpy(name_, name, sizeof(name_));
+
+    auto *h = header_();
+    h->slots  = kShmRingSlots;
+    h->width  = board.get_w();
+    h->height = board.get_h();
+    h->stride = board.get_stride();
+    h->published.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // magic last: readers ignore the segment until the header is complete
+    h->magic.store(kShmRingMagic, std::memory_order_release);
+    return true;
+  }
+
+  bool is_open() const { return base_ != nullptr; }
+
+  void publish(const LifeBoard &board, uint64_t generation) {
+    auto *h = header_();
+    uint64_t n = h->published.load(std::memory_order_relaxed);
+    char *slot = base_ + sizeof(ShmRingHeader) + (n % kShmRingSlots) * shm_detail::slot_bytes(h->stride, h->height);
+    auto *sh = reinterpret_cast<ShmSlotHeader *>(slot);
+
+    uint64_t seq = sh->seq.load(std::memory_order_relaxed);
+    sh->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    sh->generation = generation;
+    sh->population = board.population();
+    std::memcpy(slot + sizeof(ShmSlotHeader), board.row(0), sizeof(uint64_t) * static_cast<size_t>(h->stride) * h->height);
+    sh->seq.store(seq + 2, std::memory_order_release);
+    h->published.store(n + 1, std::memory_order_release);
+  }
+
+private:
+  char  *base_ {nullptr};
+  size_t size_ {0};
+  char   name_[256] {};
+
+  ShmRingHeader *header_() { return reinterpret_cast<ShmRingHeader *>(base_); }
+
+  void close_() {
+    if (!base_) { return; }
+    munmap(base_, size_);
+    shm_unlink(name_);
+    base_ = nullptr;
+  }
+};
+
+class ShmRingReader {
+public:
+  ShmRingReader() = default;
+  ShmRingReader(const ShmRingReader&) = delete;
+  ~ShmRingReader() {
+    if (base_) { munmap(const_cast<char *>(base_), size_); }
+    if (fd_ >= 0) { ::close(fd_); }
+  }
+
+  bool open(const char *name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+      SDL_Log("shm: cannot attach to %s: %s", name, strerror(errno));
+      return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(ShmRingHeader)) {
+      SDL_Log("shm: %s is not a board ring", name);
+      ::close(fd);
+      return false;
+    }
+    void *p = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+      SDL_Log("shm: mmap failed: %s", strerror(errno));
+      ::close(fd);
+      return false;
+    }
+    base_ = static_cast<const char *>(p);
+    size_ = static_cast<size_t>(st.st_size);
+
+    // read each field once: the writer side is another process and may not
+    // be well behaved, so check the values we keep, not the live header
+    const auto *h = header_();
+    const bool  ready  = h->magic.load(std::memory_order_acquire) == kShmRingMagic;
+    const int   width  = h->width;
+    const int   height = h->height;
+    const int   stride = h->stride;
+    if (!ready || h->slots != kShmRingSlots || width <= 0 || height <= 0 ||
+        stride <= 0 || stride < (width + 63) / 64 ||
+        static_cast<uint64_t>(stride) * static_cast<uint64_t>(height) > size_ / sizeof(uint64_t) ||
+        shm_detail::ring_bytes(stride, height) > size_) {
+      SDL_Log("shm: %s has an unexpected layout", name);
+      munmap(const_cast<char *>(base_), size_);
+      ::close(fd);
+      base_ = nullptr;
+      return false;
+    }
+    fd_     = fd;
+    width_  = width;
+    height_ = height;
+    stride_ = stride;
+    return true;
+  }
+
+  // Returns the newest complete frame without copying it, or false if nothing
+  // has been published yet. A slot the writer is filling (odd seq) is passed
+  // over for the one before it; false if every published slot is mid-update.
+  // Also false once the segment no longer matches what open() mapped: a writer
+  // restarting under the same name truncates it (O_TRUNC), and touching pages
+  // past the new end would raise SIGBUS.
+  bool latest(ShmFrame &frame) const {
+    struct stat st {};
+    if (fstat(fd_, &st) < 0 || static_cast<size_t>(st.st_size) < size_) { return false; }
+    const auto *h = header_();
+    if (h->width != width_ || h->height != height_ || h->stride != stride_) { return false; }
+    const uint64_t n = h->published.load(std::memory_order_acquire);
+    // the slot n % kShmRingSlots is the one the writer fills next, so skip it
+    const uint64_t tries = n < kShmRingSlots - 1 ? n : kShmRingSlots - 1;
+    const char *slot {nullptr};
+    const ShmSlotHeader *sh {nullptr};
+    uint64_t seq {1};
+    for (uint64_t k = 1; k <= tries && (seq & 1u); ++k) {
+      slot = base_ + sizeof(ShmRingHeader) + ((n - k) % kShmRingSlots) * shm_detail::slot_bytes(stride_, height_);
+      sh = reinterpret_cast<const ShmSlotHeader *>(slot);
+      seq = sh->seq.load(std::memory_order_acquire);
+    }
+    if (seq & 1u) { return false; }
+
+    frame.bits       = reinterpret_cast<const uint64_t *>(slot + sizeof(ShmSlotHeader));
+    frame.width      = width_;
+    frame.height     = height_;
+    frame.stride     = stride_;
+    frame.generation = sh->generation;
+    frame.population = sh->population;
+    frame.seq        = seq;
+    frame.slot       = sh;
+    return true;
+  }
+
+  // True if the writer has not touched the frame's slot since latest().
+  static bool still_valid(const ShmFrame &frame) {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return frame.slot && frame.slot->seq.load(std::memory_order_relaxed) == frame.seq;
+  }
+
+private:
+  const char *base_ {nullptr};
+  size_t      size_ {0};
+  int         fd_ {-1};  // kept open so latest() can notice a shrunk segment
+  int         width_ {0};
+  int         height_ {0};
+  int         stride_ {0};
+
+  const ShmRingHeader *header_() const { return reinterpret_cast<const ShmRingHeader *>(base_); }
+};
+
+#else
+
+class ShmRingWriter {
+public:
+  bool open(const char *, const LifeBoard &) { SDL_Log("shm: not supported on this platform"); return false; }
+  bool is_open() const { return false; }
+  void publish(const LifeBoard &, uint64_t) {}
+};
+
+class ShmRingReader {
+public:
+  bool open(const char *) { SDL_Log("shm: not supported on this platform"); return false; }
+  bool latest(ShmFrame &) const { return false; }
+  static bool still_valid(const ShmFrame &) { return false; }
+};
+
+#endif
@@ -0,0 +1,135 @@
+#pragma once
+// Per-generation callbacks for embedding and scripted experiments. A hook runs
+// every N generations with a read-only view of the packed board; changes it
+// wants (stamping a pattern, stopping the run) are queued and applied after
+// all due hooks have seen the same generation.
+//
+// With nothing registered, due() compares against UINT64_MAX and never fires,
+// so the step loop pays one predictable branch per generation.
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+#include "life_board.h"
+
+// Read-only view of a packed board. Rows are stride words apart.
+struct BoardView {
+  const uint64_t *bits {nullptr};
+  int      width {0};
+  int      height {0};
+  int      stride {0};
+  uint64_t generation {0};
+
+  const uint64_t *row(int y) const { return bits + static_cast<size_t>(y) * stride; }
+  bool get(int x, int y) const { return (row(y)[x >> 6] >> (x & 63)) & 1u; }
+  int parallel_grain() const { return std::max(1, 16384 / std::max(stride, 1)); }
+  uint64_t population() const {
+    return parallel_sum<uint64_t>(0, height, parallel_grain(), [this](int y0, int y1) {
+      return cpu_kernels().popcount(row(y0), static_cast<size_t>(y1 - y0) * stride);
+    });
+  }
+  uint64_t hash() const {
+    return parallel_sum<uint64_t>(0, height, parallel_grain(), [this](int y0, int y1) {
+      return cpu_kernels().hash_rows(bits, stride, y0, y1, 0);
+    });
+  }
+};
+
+// Requests a hook can make; applied once dispatch() has run every due hook.
+class HookActions {
+public:
+  void stop() { stop_ = true; }
+  void stamp(int x, int y, const LifeBoard &pattern) { stamps_.push_back({x, y, &pattern}); }
+
+private:
+  friend class HookRegistry;
+  struct Stamp { int x; int y; const LifeBoard *pattern; };
+  bool stop_ {false};
+  std::vector<Stamp> stamps_;
+};
+
+using GenerationHook = std::function<void(const BoardView &, HookActions &)>;
+
+class HookRegistry {
+public:
+  // Calls fn every `every` generations (>= 1). Returns an id for remove().
+  int add(uint64_t every, GenerationHook fn) {
+    Hook h;
+    h.id    = next_id_++;
+    h.every = every > 0 ? every : 1;
+    h.next  = last_gen_ + h.every;
+    h.fn    = std::move(fn);
+    hooks_.push_back(std::move(h));
+    update_due_();
+    return hooks_.back().id;
+  }
+
+  void remove(int id) {
+    for (size_t i = 0; i < hooks_.size(); ++i) {
+      if (hooks_[i].id == id) { hooks_.erase(hooks_.begin() + static_cast<std::ptrdiff_t>(i)); break; }
+    }
+    update_due_();
+  }
+
+  // Sets the generation the run starts from (a restored checkpoint's, say);
+  // hooks added so far next fire `every` generations after it.
+  void start(uint64_t generation) {
+    last_gen_ = generation;
+    for (Hook &h : hooks_) { h.next = generation + h.every; }
+    update_due_();
+  }
+
+  bool empty() const { return hooks_.empty(); }
+  bool due(uint64_t generation) const { return generation >= next_due_; }
+  // First generation any hook wants to see (UINT64_MAX with none registered).
+  uint64_t next_due() const { return next_due_; }
+
+  // True if the last dispatch() stamped patterns onto the board.
+  bool stamped() const { return stamped_; }
+
+  // Runs every hook due at this generation. Returns false if one asked to stop.
+  bool dispatch(LifeBoard &board, uint64_t generation) {
+    last_gen_ = generation;
+    if (!due(generation)) { return true; }
+    const BoardView view {board.row(0), board.get_w(), board.get_h(), board.get_stride(), generation};
+    HookActions actions;
+    for (Hook &h : hooks_) {
+      if (generation < h.next) { continue; }
+      h.fn(view, actions);
+      h.next = generation + h.every;
+    }
+    for (const HookActions::Stamp &s : actions.stamps_) {
+      for (int py = 0; py < s.pattern->get_h(); ++py) {
+        for (int px = 0; px < s.pattern->get_w(); ++px) {
+          int x = s.x + px, y = s.y + py;
+          if (s.pattern->get(px, py) && x >= 0 && y >= 0 && x < board.get_w() && y < board.get_h()) {
+            board.set(x, y, true);
+          }
+        }
+      }
+    }
+    stamped_ = !actions.stamps_.empty();
+    update_due_();
+    return !actions.stop_;
+  }
+
+private:
+  struct Hook {
+    int id {0};
+    uint64_t every {1};
+    uint64_t next {0};
+    GenerationHook fn;
+  };
+
+  std::vector<Hook> hooks_;
+  uint64_t next_due_ {std::numeric_limits<uint64_t>::max()};
+  uint64_t last_gen_ {0};
+  int next_id_ {1};
+  bool stamped_ {false};
+
+  void update_due_() {
+    next_due_ = std::numeric_limits<uint64_t>::max();
+    for (const Hook &h : hooks_) { next_due_ = h.next < next_due_ ? h.next : next_due_; }
+  }
+};
@@ -0,0 +1,125 @@
+#pragma once
+// Soup search on the bit-sliced batch engine, run with --soups N: N small
+// random boards are run until each settles into a still life or period-2
+// ash, dies, or hits the generation limit, and the outcomes are counted.
+// Soup i is fill_random(seed + i), so any one can be replayed on its own.
+// Every worker fills its own batch, reloading lanes as soups settle.
+#include <SDL3/SDL.h>
+#include <algorithm>
+#include <cstdint>
+#include "batch_life.h"
+#include "life_board.h"
+#include "parallel.h"
+
+struct SoupOptions {
+  int      width           {16};
+  int      height          {16};
+  int      soups           {100000};
+  uint64_t seed            {1};
+  int      density         {35};
+  uint64_t max_generations {2000};
+  Rule     rule            {};
+  int      words           {8};   // 64-board words per cell, see BatchLife
+};
+
+struct SoupCensus {
+  uint64_t died        {0};
+  uint64_t still       {0};
+  uint64_t period2     {0};
+  uint64_t unsettled   {0};   // still moving at max_generations
+  uint64_t settle_sum  {0};   // generations to settle, over soups that did
+  uint64_t ash         {0};   // live cells left, over soups that settled
+  uint64_t generations {0};   // board generations stepped, settled or not
+
+  SoupCensus &operator+=(const SoupCensus &o) {
+    died += o.died;
+    still += o.still;
+    period2 += o.period2;
+    unsettled += o.unsettled;
+    settle_sum += o.settle_sum;
+    ash += o.ash;
+    generations += o.generations;
+    return *this;
+  }
+  uint64_t total() const { return died + still + period2 + unsettled; }
+};
+
+// Runs soups [first, last) in one batch.
+inline SoupCensus search_soup_range(const SoupOptions &opt, int first, int last) {
+  SoupCensus census;
+  BatchLife batch(opt.width, opt.height, opt.words);
+  batch.set_rule(opt.rule);
+  LifeBoard soup(opt.width, opt.height);
+  int next = first;
+  auto refill = [&](int lane) {
+    if (next < last) {
+      soup.clear();
+      soup.fill_random(opt.seed + static_cast<uint64_t>(next++), opt.density);
+      batch.load(lane, soup);
+    } else {
+      batch.clear(lane);
+    }
+  };
+  for (int lane = 0; lane < batch.lanes(); ++lane) { refill(lane); }
+
+  while (batch.busy_count() > 0) {
+    batch.step();
+    for (int lane = 0; lane < batch.lanes(); ++lane) {
+      if (!batch.busy(lane)) { continue; }
+      if (batch.settled(lane)) {
+        const uint64_t pop = batch.population(lane);
+        if (pop == 0) {
+          ++census.died;
+        } else if (batch.period(lane) == 1) {
+          ++census.still;
+        } else {
+          ++census.period2;
+        }
+        census.settle_sum += batch.settle_generation(lane);
+        census.ash += pop;
+        census.generations += batch.age(lane);
+      } else if (batch.age(lane) >= opt.max_generations) {
+        ++census.unsettled;
+        census.generations += batch.age(lane);
+      } else {
+        continue;
+      }
+      refill(lane);
+    }
+  }
+  return census;
+}
+
+// Splits the soups across workers, a few batches' worth each at least.
+inline SoupCensus search_soups(const SoupOptions &opt) {
+  const int grain = std::max(1, opt.words * 64 * 4);
+  return parallel_sum<SoupCensus>(0, opt.soups, grain, [&opt](int lo, int hi) {
+    return search_soup_range(opt, lo, hi);
+  });
+}
+
+inline int run_soups(const SoupOptions &opt) {
+  if (opt.width < 1 || opt.height < 1 || opt.soups < 1 || opt.words < 1) {
+    SDL_Log("soups: bad size or count");
+    return 1;
+  }
+  char rule_text[24];
+  format_rule(opt.rule, rule_text);
+  const Uint64 start = SDL_GetPerformanceCounter();
+  const SoupCensus c = search_soups(opt);
+  const double s = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+  const uint64_t settled = c.died + c.still + c.period2;
+  SDL_Log("soups: %llu %dx%d soups of %s, %d%% density, %d boards per batch, %s kernels",
+          static_cast<unsigned long long>(c.total()), opt.width, opt.height, rule_text, opt.density,
+          opt.words * 64, cpu_kernels().name);
+  SDL_Log("soups: %llu died, %llu still, %llu period 2, %llu unsettled after %llu generations",
+          static_cast<unsigned long long>(c.died), static_cast<unsigned long long>(c.still),
+          static_cast<unsigned long long>(c.period2), static_cast<unsigned long long>(c.unsettled),
+          static_cast<unsigned long long>(opt.max_generations));
+  SDL_Log("soups: settled after %.1f generations and left %.1f cells on average",
+          settled ? static_cast<double>(c.settle_sum) / settled : 0.0,
+          settled ? static_cast<double>(c.ash) / settled : 0.0);
+  SDL_Log("soups: %.3f s, %.0f soups/s, %.2f Gcell/s", s, c.total() / s,
+          static_cast<double>(c.generations) * opt.width * opt.height / s / 1e9);
+  return 0;
+}